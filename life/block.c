@@ -0,0 +1,377 @@
+/**
+ * @file block.c
+ * @author YAN SUN
+ * @version 1.0
+ *
+ * @section DESCRIPTION
+ * Lookup table Game of Life engine.
+ * Cells are stored in 2x2 blocks, one block of four bits to a byte.
+ * The next generation of a 2x2 block depends only on the 4x4 square
+ * round it, so a table of 65536 entries gives the inner block of any
+ * 4x4 square in one lookup. Its entries are packed two to a byte,
+ * 32KB, so the table stays in the first level cache.
+ * The blocks of one generation sit one cell up and to the left of the
+ * blocks of the next, so the square round a new block is exactly four
+ * old blocks and no bits have to be gathered from their neighbours.
+ * The blocks of even generations start one cell before the board,
+ * those of odd generations on it, and each phase has its own buffer.
+ * Cells past the edge are dead: the blocks that reach past it are
+ * masked after every step. A table is built once for each rule and
+ * kept, so creating an engine costs no more than allocating it.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "life.h"
+
+/* Entries in the table, one for every 4x4 square */
+#define BLOCK_SQUARES 65536
+/* Cells of a block in its left and right column, top and bottom row */
+#define BLOCK_LEFT 0x5
+#define BLOCK_RIGHT 0xA
+#define BLOCK_TOP 0x3
+#define BLOCK_BOTTOM 0xC
+
+/* Next block of every 4x4 square under one rule */
+struct blockTable{
+  Rule rule;
+  unsigned char entries[BLOCK_SQUARES / 2];
+  struct blockTable *next;
+};
+typedef struct blockTable BlockTable;
+
+struct block{
+  int x;
+  int y;
+  /* Blocks across and down in each phase */
+  int across[2];
+  int down[2];
+  /* Distance between rows of blocks, a guard block either side */
+  int stride;
+  /* Phase of the current generation, 0 when its blocks start one
+     cell before the board */
+  int phase;
+  /* Cells of the first and last block of a row or column of each
+     phase that are on the board */
+  unsigned char left[2];
+  unsigned char right[2];
+  unsigned char top[2];
+  unsigned char bottom[2];
+  unsigned char *blocks[2];
+  const unsigned char *table;
+};
+typedef struct block Block;
+
+static void *blockCreate(Grid *g);
+static void *blockBlank(int x, int y);
+static void blockLive(void *state, int i, int j, int n);
+static void blockStep(void *state);
+static void blockJump(void *state, uint64_t generations);
+static void blockBand(void *state, uint64_t generation, int row0, int row1);
+static void blockStore(void *state, Grid *g);
+static void blockDestroy(void *state);
+static unsigned char *blockCell(Block *s, int i, int j, int *bit);
+static int edgeMask(int cell, int n, int first, int second);
+static const unsigned char *findTable(Rule *rule);
+static void fillTable(BlockTable *t);
+static int squareCells(int square);
+
+Engine blockEngine = {"block", blockCreate, blockStep, blockStore,
+		      blockDestroy, blockJump, blockBlank, blockLive,
+		      NULL, NULL, NULL, 1, 0};
+
+/* Tables built so far, one for each rule */
+static BlockTable *blockTables = NULL;
+static pthread_mutex_t tableLock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * Copy the grid into blocks.
+ *
+ * @param g Grid
+ * @return The new engine state
+ */
+static void *blockCreate(Grid *g){
+  Block *s;
+  int i, j;
+  s = (Block *)blockBlank(g->x, g->y);
+  for(j = 0; j < g->y; j++){
+    for(i = 0; i < g->x; i++){
+      if(CELL(g, i, j) == ALIVE){
+	blockLive(s, i, j, 1);
+      }
+    }
+  }
+  return s;
+}
+/**
+ * Create a block engine with every cell dead, in the phase whose
+ * blocks start one cell before the board.
+ * The table is the current rule's.
+ *
+ * @param x Number of columns
+ * @param y Number of rows
+ * @return The new engine state
+ */
+static void *blockBlank(int x, int y){
+  Block *s;
+  int p, size;
+  s = (Block *)malloc(sizeof(Block));
+  if(s == NULL){
+    printf("Cannot Allocate Engine\n");
+    exit(2);
+  }
+  s->x = x;
+  s->y = y;
+  s->across[0] = x / 2 + 1;
+  s->across[1] = (x + 1) / 2;
+  s->down[0] = y / 2 + 1;
+  s->down[1] = (y + 1) / 2;
+  s->stride = s->across[0] + 2;
+  s->phase = 0;
+  for(p = 0; p < 2; p++){
+    s->left[p] = edgeMask(-1 + p, x, BLOCK_LEFT, BLOCK_RIGHT);
+    s->right[p] = edgeMask(2 * s->across[p] - 3 + p, x,
+			   BLOCK_LEFT, BLOCK_RIGHT);
+    s->top[p] = edgeMask(-1 + p, y, BLOCK_TOP, BLOCK_BOTTOM);
+    s->bottom[p] = edgeMask(2 * s->down[p] - 3 + p, y,
+			    BLOCK_TOP, BLOCK_BOTTOM);
+  }
+  /* Guard blocks are zeroed once and never written */
+  size = (s->down[0] + 2) * s->stride;
+  s->blocks[0] = (unsigned char *)calloc(size, 1);
+  s->blocks[1] = (unsigned char *)calloc(size, 1);
+  s->table = findTable(&lifeRule);
+  if(s->blocks[0] == NULL || s->blocks[1] == NULL){
+    printf("Cannot Allocate Engine\n");
+    exit(2);
+  }
+  return s;
+}
+/**
+ * Make a run of cells alive.
+ *
+ * @param state Engine state
+ * @param i First column of the run
+ * @param j Row
+ * @param n Length of the run
+ */
+static void blockLive(void *state, int i, int j, int n){
+  Block *s;
+  unsigned char *b;
+  int bit;
+  s = (Block *)state;
+  for(; n > 0; i++, n--){
+    b = blockCell(s, i, j, &bit);
+    *b |= bit;
+  }
+}
+/**
+ * Calculate the next generation.
+ *
+ * @param state Engine state
+ */
+static void blockStep(void *state){
+  blockJump(state, 1);
+}
+/**
+ * Calculate a number of generations in bands across the thread pool.
+ * The bands are rows of blocks, as many as the phase with more of
+ * them, and every generation moves the board to the other phase.
+ *
+ * @param state Engine state
+ * @param generations Number of generations
+ */
+static void blockJump(void *state, uint64_t generations){
+  Block *s;
+  s = (Block *)state;
+  poolRun(blockBand, s, s->down[0], generations);
+  s->phase = (int)((s->phase + generations) % 2);
+}
+/**
+ * Calculate one generation of a band of rows of blocks.
+ * Block p of a row of the next generation is looked up from blocks p
+ * and p + 1 of two rows of the current one, both counting the guard
+ * block, if the next generation starts on the board, and from blocks
+ * p - 1 and p otherwise.
+ *
+ * @param state Engine state
+ * @param generation Generation of the job, counted from the jump
+ * @param row0 First row of blocks of the band
+ * @param row1 Row of blocks after the band
+ */
+static void blockBand(void *state, uint64_t generation, int row0, int row1){
+  Block *s;
+  const unsigned char *up, *down, *table;
+  unsigned char *out;
+  int to, last, p, q, square;
+  s = (Block *)state;
+  to = (int)((s->phase + generation + 1) % 2);
+  last = s->across[to] - 1;
+  table = s->table;
+  for(q = row0; q < row1 && q < s->down[to]; q++){
+    up = s->blocks[1 - to] + (size_t)(q + to) * s->stride + to;
+    down = up + s->stride;
+    out = s->blocks[to] + (size_t)(q + 1) * s->stride + 1;
+    for(p = 0; p <= last; p++){
+      square = up[p] | up[p + 1] << 4 | down[p] << 8 | down[p + 1] << 12;
+      out[p] = (table[square >> 1] >> ((square & 1) << 2)) & 0xF;
+    }
+    /* Cells past the edge stay dead */
+    out[0] &= s->left[to];
+    out[last] &= s->right[to];
+    if(q == 0){
+      for(p = 0; p <= last; p++){
+	out[p] &= s->top[to];
+      }
+    }
+    if(q == s->down[to] - 1){
+      for(p = 0; p <= last; p++){
+	out[p] &= s->bottom[to];
+      }
+    }
+  }
+}
+/**
+ * Copy the current generation back into the grid.
+ *
+ * @param state Engine state
+ * @param g Grid
+ */
+static void blockStore(void *state, Grid *g){
+  Block *s;
+  unsigned char *b;
+  int i, j, bit;
+  s = (Block *)state;
+  for(j = 0; j < s->y; j++){
+    for(i = 0; i < s->x; i++){
+      b = blockCell(s, i, j, &bit);
+      CELL(g, i, j) = *b & bit ? ALIVE : DEAD;
+    }
+  }
+}
+/**
+ * Free an engine state. Its table is kept for the next.
+ *
+ * @param state Engine state
+ */
+static void blockDestroy(void *state){
+  Block *s;
+  s = (Block *)state;
+  free(s->blocks[0]);
+  free(s->blocks[1]);
+  free(s);
+}
+/**
+ * Find the block holding a cell in the current phase.
+ * A block's bits are its top row left to right, then its bottom row.
+ *
+ * @param s Engine state
+ * @param i Column
+ * @param j Row
+ * @param bit Set to the cell's bit in the block
+ * @return The block
+ */
+static unsigned char *blockCell(Block *s, int i, int j, int *bit){
+  int start;
+  /* Cells counted from the first block, which starts one cell before
+     the board in phase 0 */
+  start = 1 - s->phase;
+  i += start;
+  j += start;
+  *bit = 1 << ((j % 2) * 2 + i % 2);
+  return s->blocks[s->phase] + (size_t)(j / 2 + 1) * s->stride + i / 2 + 1;
+}
+/**
+ * Mask of the cells of a block that are on the board, across or down.
+ *
+ * @param cell First column or row of the block, may be off the board
+ * @param n Number of columns or rows on the board
+ * @param first Bits of the block's first column or row
+ * @param second Bits of its second column or row
+ * @return Bits of the cells on the board
+ */
+static int edgeMask(int cell, int n, int first, int second){
+  return (cell >= 0 && cell < n ? first : 0) |
+    (cell + 1 >= 0 && cell + 1 < n ? second : 0);
+}
+/**
+ * Find the table of a rule, building it if there is none yet.
+ * Engines are created on the census's threads, so the list is locked.
+ *
+ * @param rule Rule
+ * @return The table
+ */
+static const unsigned char *findTable(Rule *rule){
+  BlockTable *t;
+  pthread_mutex_lock(&tableLock);
+  for(t = blockTables; t != NULL; t = t->next){
+    if(t->rule.birth == rule->birth && t->rule.survive == rule->survive){
+      break;
+    }
+  }
+  if(t == NULL){
+    t = (BlockTable *)malloc(sizeof(BlockTable));
+    if(t == NULL){
+      printf("Cannot Allocate Engine\n");
+      exit(2);
+    }
+    t->rule = *rule;
+    fillTable(t);
+    t->next = blockTables;
+    blockTables = t;
+  }
+  pthread_mutex_unlock(&tableLock);
+  return t->entries;
+}
+/**
+ * Fill a table from its rule. The next state of a cell is first found
+ * for each of the 512 3x3 squares round it, then the four inner cells
+ * of every 4x4 square are read from those.
+ * Square k is four blocks, four bits each: top left, top right,
+ * bottom left then bottom right. Entry k is the low half of byte k / 2
+ * when k is even and the high half when it is odd.
+ *
+ * @param t Table
+ */
+static void fillTable(BlockTable *t){
+  unsigned char next[512];
+  int k, n, c, count, cells, bits, row, column;
+  for(k = 0; k < 512; k++){
+    count = 0;
+    for(c = 0; c < 9; c++){
+      count += c != 4 && (k >> c) & 1;
+    }
+    next[k] = (((k >> 4) & 1 ? t->rule.survive : t->rule.birth) >> count) & 1;
+  }
+  memset(t->entries, 0, sizeof(t->entries));
+  for(k = 0; k < BLOCK_SQUARES; k++){
+    cells = squareCells(k);
+    bits = 0;
+    for(row = 0; row < 2; row++){
+      for(column = 0; column < 2; column++){
+	n = (cells >> (row * 4 + column)) & 7;
+	n |= ((cells >> ((row + 1) * 4 + column)) & 7) << 3;
+	n |= ((cells >> ((row + 2) * 4 + column)) & 7) << 6;
+	bits |= next[n] << (row * 2 + column);
+      }
+    }
+    t->entries[k >> 1] |= bits << ((k & 1) << 2);
+  }
+}
+/**
+ * Lay the four blocks of a square out as its cells, row by row.
+ *
+ * @param square Four blocks of the square
+ * @return Cell c of row r of the square in bit r * 4 + c
+ */
+static int squareCells(int square){
+  int k, b, cells;
+  cells = 0;
+  for(k = 0; k < 4; k++){
+    b = (square >> (k * 4)) & 0xF;
+    /* Block k is two columns right when odd, two rows down from 2 */
+    cells |= ((b & 3) | (b & 0xC) << 2) << ((k & 1) * 2 + (k >> 1) * 8);
+  }
+  return cells;
+}
@@ -0,0 +1,1015 @@
+/**
+ * @file census.c
+ * @author YAN SUN
+ * @version 1.0
+ *
+ * @section DESCRIPTION
+ * Census of the objects random soups settle into.
+ * A soup is a square of random cells in the middle of a bounded board
+ * CENSUS_SCALE times as wide, made from the seed and its own number
+ * alone, so a census comes out the same on any number of threads.
+ * Every thread has an engine state of its own and takes soups a batch
+ * at a time from a shared counter, running each until runCycles finds
+ * the board repeating. The live cells are then split into objects:
+ * cells within two of each other are gathered together, since the
+ * halves of an oscillator such as the toad or the beacon come apart
+ * in some phases, then the touching pieces of the gathering are only
+ * kept together when they evolve differently apart than side by side,
+ * so objects that merely lie close are still counted alone. An object
+ * is followed on a small board of
+ * its own until its shape comes back, which gives its period and
+ * whether it moves, and is named by the least of its images over every
+ * phase, rotation and reflection, so an object is counted as one kind
+ * however it lies. Names start like apgsearch's codes: xs and the
+ * population for a still life, xp and the period for an oscillator,
+ * xq and the period for a ship, zz for an object that never repeats.
+ * The threads keep tallies of their own, added up at the end.
+ * Objects touching a dead edge were shaped by the wall, so they are
+ * only counted; on a torus ships go round and are named like the rest.
+ */
+#define _POSIX_C_SOURCE 200112L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "life.h"
+
+#define CENSUS_SCALE 4
+#define CENSUS_SOUP 16
+#define CENSUS_GENERATIONS 10000
+/* Soups a thread takes at once */
+#define CENSUS_BATCH 16
+/* Generations an object is followed to find its period */
+#define CENSUS_PHASES 64
+/* Room round an object for a ship to fly while it is followed */
+#define CENSUS_MARGIN (CENSUS_PHASES / 2 + 2)
+#define CENSUS_TABLE 256
+#define CODE_LENGTH 32
+#define SPLITMIX_GAMMA 0x9E3779B97F4A7C15ULL
+#define FNV_OFFSET 0xCBF29CE484222325ULL
+#define FNV_PRIME 0x100000001B3ULL
+#define NANOSECONDS 1000000000.0
+
+/* Box round some cells, both ends included */
+struct box{
+  int left;
+  int top;
+  int right;
+  int bottom;
+};
+typedef struct box Box;
+
+/* One kind of object and how often it was found */
+struct kind{
+  char *name;
+  uint64_t hash;
+  uint64_t count;
+};
+typedef struct kind Kind;
+
+/* The kinds one thread has found, an open-addressed table */
+struct tally{
+  Kind *kinds;
+  size_t size;
+  size_t used;
+  uint64_t objects;
+  /* Soups with no cycle in the generations allowed */
+  uint64_t unsettled;
+  /* Objects touching a dead edge or wrapped round a torus */
+  uint64_t edge;
+};
+typedef struct tally Tally;
+
+/* The census the threads share */
+struct census{
+  Engine *engine;
+  int soup;
+  int side;
+  uint64_t soups;
+  uint64_t seed;
+  uint64_t generations;
+  pthread_mutex_t lock;
+  uint64_t next;
+};
+typedef struct census Census;
+
+/* One thread, its tally and the room it takes boards apart in */
+struct worker{
+  Census *census;
+  pthread_t thread;
+  Tally tally;
+  Grid *board;
+  /* Cells already put in an object */
+  unsigned char *seen;
+  /* Cells of the object being gathered, across the edge on a torus */
+  int *column;
+  int *row;
+  /* Group of each gathered cell, the cell's own number at its root */
+  int *group;
+  /* One more than the cell gathered at each place on the boards, 0
+     where there is none */
+  int *label;
+  /* Boards an object is followed on, with a margin round it, each
+     next board left dead by stepBoard */
+  unsigned char *cells;
+  unsigned char *next;
+  unsigned char *first;
+  /* Boards two groups are followed on apart, to see if they interact */
+  unsigned char *apart[2];
+  unsigned char *apartNext[2];
+  int stride;
+  char *best;
+  char *image;
+  char *name;
+};
+typedef struct worker Worker;
+
+static void *censusWorker(void *arg);
+static void runSoup(Worker *w, uint64_t number);
+static void fillSoup(Grid *g, int soup, uint64_t seed, uint64_t number);
+static void initWorker(Worker *w, int x, int y);
+static void freeWorker(Worker *w);
+static void takeApart(Worker *w, int topology);
+static int gatherObject(Worker *w, int i, int j, int topology, Box *box);
+static void splitObject(Worker *w, int n, Box *box);
+static int placeOf(Worker *w, Box *box, int k);
+static int nearGroups(Worker *w, int n, Box *box, int a, int b);
+static int interact(Worker *w, int n, Box *box, int a, int b);
+static void joinGroups(Worker *w, int a, int b);
+static int findGroup(Worker *w, int k);
+static void nameObject(Worker *w, int n, int group);
+static void stepBoard(unsigned char **cells, unsigned char **next,
+		      int stride, Box *box);
+static int sameShape(Worker *w, Box *box, Box *start);
+static void leastImage(Worker *w, Box *box);
+static void addKind(Tally *t, char *name, uint64_t count);
+static Kind **sortKinds(Tally *t, size_t *n);
+static int compareKinds(const void *a, const void *b);
+static uint64_t hashName(char *name);
+static uint64_t splitMix(uint64_t *state);
+
+/**
+ * Run a census of random soups and tally the objects they leave.
+ * Each thread steps its own engine state, so the engines' own thread
+ * pool should be left at one thread.
+ *
+ * @param engine Engine, bounded
+ * @param soups Number of soups
+ * @param soup Side of a soup, 0 for CENSUS_SOUP
+ * @param seed Seed of the soups
+ * @param generations Most generations a soup runs, 0 for
+ * CENSUS_GENERATIONS
+ * @param threads Number of threads, 0 for one per processor
+ * @param report 1 to print the tally and the soups a second
+ * @return Hash of the tally, the same for any number of threads
+ */
+uint64_t takeCensus(Engine *engine, uint64_t soups, int soup, uint64_t seed,
+		    uint64_t generations, int threads, int report){
+  struct timespec start, end;
+  Census c;
+  Worker *workers;
+  Tally *total;
+  Kind **sorted;
+  double seconds;
+  uint64_t h;
+  size_t k, n;
+  int t;
+  if(threads <= 0){
+    threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+  }
+  if(threads < 1){
+    threads = 1;
+  }
+  c.engine = engine;
+  c.soup = soup > 0 ? soup : CENSUS_SOUP;
+  c.side = c.soup * CENSUS_SCALE;
+  c.soups = soups;
+  c.seed = seed;
+  c.generations = generations > 0 ? generations : CENSUS_GENERATIONS;
+  c.next = 0;
+  workers = (Worker *)calloc(threads, sizeof(Worker));
+  if(workers == NULL || pthread_mutex_init(&c.lock, NULL) != 0){
+    printf("Cannot Allocate Census\n");
+    exit(2);
+  }
+  for(t = 0; t < threads; t++){
+    workers[t].census = &c;
+    initWorker(&workers[t], c.side, c.side);
+  }
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  /* The calling thread is the first worker */
+  for(t = 1; t < threads; t++){
+    if(pthread_create(&workers[t].thread, NULL, censusWorker, &workers[t]) != 0){
+      printf("Cannot Start Threads\n");
+      exit(2);
+    }
+  }
+  censusWorker(&workers[0]);
+  for(t = 1; t < threads; t++){
+    pthread_join(workers[t].thread, NULL);
+  }
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  seconds = (end.tv_sec - start.tv_sec) +
+    (end.tv_nsec - start.tv_nsec) / NANOSECONDS;
+  total = &workers[0].tally;
+  for(t = 1; t < threads; t++){
+    for(k = 0; k < workers[t].tally.size; k++){
+      if(workers[t].tally.kinds[k].name != NULL){
+	addKind(total, workers[t].tally.kinds[k].name,
+		workers[t].tally.kinds[k].count);
+      }
+    }
+    total->objects += workers[t].tally.objects;
+    total->unsettled += workers[t].tally.unsettled;
+    total->edge += workers[t].tally.edge;
+  }
+  sorted = sortKinds(total, &n);
+  h = FNV_OFFSET;
+  for(k = 0; k < n; k++){
+    h = (h ^ sorted[k]->hash) * FNV_PRIME;
+    h = (h ^ sorted[k]->count) * FNV_PRIME;
+  }
+  h = (h ^ total->unsettled) * FNV_PRIME;
+  h = (h ^ total->edge) * FNV_PRIME;
+  if(report){
+    printf("Census of %llu soups of %dx%d on %dx%d %s boards, seed %llu, "
+	   "%d threads\n", (unsigned long long)soups, c.soup, c.soup,
+	   c.side, c.side, topologyName(lifeTopology),
+	   (unsigned long long)seed, threads);
+    printf("%.3f seconds, %.1f soups/s, %llu objects of %llu kinds\n",
+	   seconds, seconds > 0 ? soups / seconds : 0.0,
+	   (unsigned long long)total->objects, (unsigned long long)n);
+    for(k = 0; k < n; k++){
+      printf("%12llu %s\n", (unsigned long long)sorted[k]->count,
+	     sorted[k]->name);
+    }
+    printf("%12llu soups unsettled after %llu generations\n",
+	   (unsigned long long)total->unsettled,
+	   (unsigned long long)c.generations);
+    printf("%12llu objects at the edge\n", (unsigned long long)total->edge);
+  }
+  free(sorted);
+  for(t = 0; t < threads; t++){
+    freeWorker(&workers[t]);
+  }
+  pthread_mutex_destroy(&c.lock);
+  free(workers);
+  return h;
+}
+/**
+ * Name the objects on a board the way a census would.
+ *
+ * @param g Board, in the current topology
+ * @return The names, most common first and split by spaces, leaving
+ * out objects at the edge. To be freed by the caller
+ */
+char *censusNames(Grid *g){
+  Worker w;
+  Kind **sorted;
+  char *names;
+  size_t k, n, length;
+  uint64_t c;
+  memset(&w, 0, sizeof(Worker));
+  initWorker(&w, g->x, g->y);
+  memcpy(w.board->cells, g->cells, (size_t)g->x * g->y);
+  takeApart(&w, lifeTopology);
+  sorted = sortKinds(&w.tally, &n);
+  length = 1;
+  for(k = 0; k < n; k++){
+    length += (strlen(sorted[k]->name) + 1) * sorted[k]->count;
+  }
+  names = (char *)malloc(length);
+  if(names == NULL){
+    printf("Cannot Allocate Census\n");
+    exit(2);
+  }
+  names[0] = '\0';
+  for(k = 0; k < n; k++){
+    for(c = 0; c < sorted[k]->count; c++){
+      if(names[0] != '\0'){
+	strcat(names, " ");
+      }
+      strcat(names, sorted[k]->name);
+    }
+  }
+  free(sorted);
+  freeWorker(&w);
+  return names;
+}
+/**
+ * Allocate a worker's board and the room it takes boards apart in.
+ *
+ * @param w Worker, zeroed
+ * @param x Number of columns of the boards
+ * @param y Number of rows of the boards
+ */
+static void initWorker(Worker *w, int x, int y){
+  size_t area;
+  int side, b;
+  side = x > y ? x : y;
+  w->stride = side + 2 * CENSUS_MARGIN;
+  area = (size_t)w->stride * w->stride;
+  w->board = allocateGrid(x, y);
+  w->seen = (unsigned char *)malloc((size_t)x * y);
+  w->column = (int *)malloc(sizeof(int) * x * y);
+  w->row = (int *)malloc(sizeof(int) * x * y);
+  w->group = (int *)malloc(sizeof(int) * x * y);
+  w->label = (int *)calloc(area, sizeof(int));
+  w->cells = (unsigned char *)calloc(area, 1);
+  w->next = (unsigned char *)calloc(area, 1);
+  w->first = (unsigned char *)malloc(area);
+  for(b = 0; b < 2; b++){
+    w->apart[b] = (unsigned char *)calloc(area, 1);
+    w->apartNext[b] = (unsigned char *)calloc(area, 1);
+  }
+  /* An image is a row of cells and a '/' for every row of the box */
+  w->best = (char *)malloc(area + w->stride + 1);
+  w->image = (char *)malloc(area + w->stride + 1);
+  w->name = (char *)malloc(area + w->stride + CODE_LENGTH);
+  if(w->seen == NULL || w->column == NULL || w->row == NULL ||
+     w->group == NULL || w->label == NULL || w->cells == NULL ||
+     w->next == NULL || w->first == NULL || w->apart[0] == NULL ||
+     w->apart[1] == NULL || w->apartNext[0] == NULL ||
+     w->apartNext[1] == NULL || w->best == NULL || w->image == NULL ||
+     w->name == NULL){
+    printf("Cannot Allocate Census\n");
+    exit(2);
+  }
+}
+/**
+ * Free a worker's tally, board and room.
+ *
+ * @param w Worker
+ */
+static void freeWorker(Worker *w){
+  size_t k;
+  int b;
+  for(k = 0; k < w->tally.size; k++){
+    free(w->tally.kinds[k].name);
+  }
+  free(w->tally.kinds);
+  freeGrid(w->board);
+  free(w->seen);
+  free(w->column);
+  free(w->row);
+  free(w->group);
+  free(w->label);
+  free(w->cells);
+  free(w->next);
+  free(w->first);
+  for(b = 0; b < 2; b++){
+    free(w->apart[b]);
+    free(w->apartNext[b]);
+  }
+  free(w->best);
+  free(w->image);
+  free(w->name);
+}
+/**
+ * Take batches of soups until there are none left.
+ *
+ * @param arg Worker
+ * @return NULL
+ */
+static void *censusWorker(void *arg){
+  Worker *w;
+  Census *c;
+  uint64_t first, n;
+  w = (Worker *)arg;
+  c = w->census;
+  for(;;){
+    pthread_mutex_lock(&c->lock);
+    first = c->next;
+    c->next += CENSUS_BATCH;
+    pthread_mutex_unlock(&c->lock);
+    for(n = first; n < first + CENSUS_BATCH && n < c->soups; n++){
+      runSoup(w, n);
+    }
+    if(n >= c->soups){
+      return NULL;
+    }
+  }
+}
+/**
+ * Run one soup until it repeats and tally what it leaves.
+ *
+ * @param w Worker
+ * @param number Soup number
+ */
+static void runSoup(Worker *w, uint64_t number){
+  Census *c;
+  Cycle cycle;
+  void *state;
+  c = w->census;
+  fillSoup(w->board, c->soup, c->seed, number);
+  state = c->engine->create(w->board);
+  runCycles(c->engine, state, c->side, c->side, c->generations, 0, &cycle);
+  if(cycle.period == 0){
+    w->tally.unsettled++;
+  }
+  else{
+    c->engine->store(state, w->board);
+    takeApart(w, lifeTopology);
+  }
+  c->engine->destroy(state);
+}
+/**
+ * Fill a board with one soup in the middle, each cell alive by a coin
+ * toss. The tosses come from the seed and the soup's number alone.
+ *
+ * @param g Board
+ * @param soup Side of the soup
+ * @param seed Seed of the census
+ * @param number Soup number
+ */
+static void fillSoup(Grid *g, int soup, uint64_t seed, uint64_t number){
+  uint64_t state, bits;
+  int i, j, k, offset;
+  memset(g->cells, DEAD, (size_t)g->x * g->y);
+  state = seed ^ (number * SPLITMIX_GAMMA);
+  offset = (g->x - soup) / 2;
+  bits = 0;
+  k = 0;
+  for(j = 0; j < soup; j++){
+    for(i = 0; i < soup; i++, k--){
+      if(k == 0){
+	bits = splitMix(&state);
+	k = 64;
+      }
+      if(bits & 1){
+	CELL(g, offset + i, offset + j) = ALIVE;
+      }
+      bits >>= 1;
+    }
+  }
+}
+/**
+ * Split a settled board into objects and tally each one.
+ *
+ * @param w Worker, its board holding the settled soup
+ * @param topology Topology of the board
+ */
+static void takeApart(Worker *w, int topology){
+  Grid *g;
+  Box box;
+  int i, j, k, n;
+  g = w->board;
+  memset(w->seen, 0, (size_t)g->x * g->y);
+  for(j = 0; j < g->y; j++){
+    for(i = 0; i < g->x; i++){
+      if(CELL(g, i, j) != ALIVE || w->seen[(size_t)j * g->x + i]){
+	continue;
+      }
+      n = gatherObject(w, i, j, topology, &box);
+      if(n == 0){
+	w->tally.objects++;
+	w->tally.edge++;
+	continue;
+      }
+      splitObject(w, n, &box);
+      for(k = 0; k < n; k++){
+	if(w->group[k] == k){
+	  nameObject(w, n, k);
+	  addKind(&w->tally, w->name, 1);
+	  w->tally.objects++;
+	}
+      }
+    }
+  }
+}
+/**
+ * Gather the cells within two of a live cell, and the cells within two
+ * of them, into the worker's list. On a torus the cells may cross the
+ * edge, so they are listed as if the board carried on past it.
+ *
+ * @param w Worker
+ * @param i Column of the first cell
+ * @param j Row of the first cell
+ * @param topology Topology of the board
+ * @param box Set to the box round the cells
+ * @return Number of cells, 0 if a cell touches a dead edge or they
+ * wrap right round a torus
+ */
+static int gatherObject(Worker *w, int i, int j, int topology, Box *box){
+  Grid *g;
+  int n, k, di, dj, a, b, edge;
+  g = w->board;
+  w->column[0] = i;
+  w->row[0] = j;
+  w->seen[(size_t)j * g->x + i] = 1;
+  box->left = box->right = i;
+  box->top = box->bottom = j;
+  edge = 0;
+  for(k = 0, n = 1; k < n; k++){
+    for(dj = -2; dj <= 2; dj++){
+      for(di = -2; di <= 2; di++){
+	a = w->column[k] + di;
+	b = w->row[k] + dj;
+	if(topology == TOPOLOGY_DEAD){
+	  if(a < 0 || b < 0 || a >= g->x || b >= g->y){
+	    /* Only a cell next to the edge was shaped by it */
+	    edge |= abs(di) <= 1 && abs(dj) <= 1;
+	    continue;
+	  }
+	}
+	a = (a % g->x + g->x) % g->x;
+	b = (b % g->y + g->y) % g->y;
+	if(CELL(g, a, b) != ALIVE || w->seen[(size_t)b * g->x + a]){
+	  continue;
+	}
+	w->seen[(size_t)b * g->x + a] = 1;
+	w->column[n] = w->column[k] + di;
+	w->row[n] = w->row[k] + dj;
+	box->left = w->column[n] < box->left ? w->column[n] : box->left;
+	box->right = w->column[n] > box->right ? w->column[n] : box->right;
+	box->top = w->row[n] < box->top ? w->row[n] : box->top;
+	box->bottom = w->row[n] > box->bottom ? w->row[n] : box->bottom;
+	n++;
+      }
+    }
+  }
+  if(edge || box->right - box->left + 1 >= g->x ||
+     box->bottom - box->top + 1 >= g->y){
+    return 0;
+  }
+  return n;
+}
+/**
+ * Group the gathered cells into objects. Touching cells are always
+ * one object. Two groups within two of each other are joined if they
+ * interact, and the groups are looked over again after any join, as
+ * a bigger group may interact with one the smaller did not.
+ *
+ * @param w Worker, with the cells gathered
+ * @param n Number of cells
+ * @param box Box round the cells
+ */
+static void splitObject(Worker *w, int n, Box *box){
+  int k, m, a, b, di, dj, joined;
+  for(k = 0; k < n; k++){
+    w->group[k] = k;
+    w->label[placeOf(w, box, k)] = k + 1;
+  }
+  for(k = 0; k < n; k++){
+    for(dj = -1; dj <= 1; dj++){
+      for(di = -1; di <= 1; di++){
+	m = w->label[placeOf(w, box, k) + dj * w->stride + di] - 1;
+	if(m >= 0){
+	  joinGroups(w, findGroup(w, k), findGroup(w, m));
+	}
+      }
+    }
+  }
+  do{
+    joined = 0;
+    for(a = 0; a < n; a++){
+      for(b = a + 1; b < n && findGroup(w, a) == a; b++){
+	if(findGroup(w, b) == b && nearGroups(w, n, box, a, b) &&
+	   interact(w, n, box, a, b)){
+	  joinGroups(w, a, b);
+	  joined = 1;
+	}
+      }
+    }
+  }while(joined);
+  for(k = 0; k < n; k++){
+    w->label[placeOf(w, box, k)] = 0;
+    w->group[k] = findGroup(w, k);
+  }
+}
+/**
+ * Where a gathered cell lies on the boards objects are followed on.
+ *
+ * @param w Worker, with the cells gathered
+ * @param box Box round the cells
+ * @param k Cell
+ * @return Offset of the cell on a board
+ */
+static int placeOf(Worker *w, Box *box, int k){
+  return (w->row[k] - box->top + CENSUS_MARGIN) * w->stride +
+    w->column[k] - box->left + CENSUS_MARGIN;
+}
+/**
+ * Whether any cell of one group is within two of the other group.
+ *
+ * @param w Worker, with the cells gathered and labelled
+ * @param n Number of cells
+ * @param box Box round the cells
+ * @param a First group
+ * @param b Second group
+ * @return 1 if they are near, 0 otherwise
+ */
+static int nearGroups(Worker *w, int n, Box *box, int a, int b){
+  int k, m, di, dj;
+  for(k = 0; k < n; k++){
+    if(findGroup(w, k) != a){
+      continue;
+    }
+    for(dj = -2; dj <= 2; dj++){
+      for(di = -2; di <= 2; di++){
+	m = w->label[placeOf(w, box, k) + dj * w->stride + di] - 1;
+	if(m >= 0 && findGroup(w, m) == b){
+	  return 1;
+	}
+      }
+    }
+  }
+  return 0;
+}
+/**
+ * Whether two groups of cells interact, following them side by side
+ * and each on a board of its own for CENSUS_PHASES generations, or
+ * until one reaches the margin. Two objects that do not interact are
+ * the same side by side as they are apart.
+ *
+ * @param w Worker, with the cells gathered
+ * @param n Number of cells
+ * @param box Box round the cells
+ * @param a First group
+ * @param b Second group
+ * @return 1 if they ever differ, 0 otherwise
+ */
+static int interact(Worker *w, int n, Box *box, int a, int b){
+  Box both, apart[2], all;
+  size_t place, area;
+  int k, g, phase, i, j, side;
+  area = (size_t)w->stride * w->stride;
+  memset(w->cells, 0, area);
+  memset(w->apart[0], 0, area);
+  memset(w->apart[1], 0, area);
+  for(side = 0; side < 2; side++){
+    apart[side].left = apart[side].top = w->stride;
+    apart[side].right = apart[side].bottom = -1;
+  }
+  for(k = 0; k < n; k++){
+    g = findGroup(w, k);
+    if(g != a && g != b){
+      continue;
+    }
+    side = g == b;
+    i = w->column[k] - box->left + CENSUS_MARGIN;
+    j = w->row[k] - box->top + CENSUS_MARGIN;
+    place = placeOf(w, box, k);
+    w->cells[place] = w->apart[side][place] = 1;
+    apart[side].left = i < apart[side].left ? i : apart[side].left;
+    apart[side].right = i > apart[side].right ? i : apart[side].right;
+    apart[side].top = j < apart[side].top ? j : apart[side].top;
+    apart[side].bottom = j > apart[side].bottom ? j : apart[side].bottom;
+  }
+  both.left = apart[0].left < apart[1].left ? apart[0].left : apart[1].left;
+  both.right = apart[0].right > apart[1].right ?
+    apart[0].right : apart[1].right;
+  both.top = apart[0].top < apart[1].top ? apart[0].top : apart[1].top;
+  both.bottom = apart[0].bottom > apart[1].bottom ?
+    apart[0].bottom : apart[1].bottom;
+  for(phase = 1; phase <= CENSUS_PHASES; phase++){
+    stepBoard(&w->cells, &w->next, w->stride, &both);
+    for(side = 0; side < 2; side++){
+      stepBoard(&w->apart[side], &w->apartNext[side], w->stride, &apart[side]);
+    }
+    all = both;
+    for(side = 0; side < 2; side++){
+      if(apart[side].right >= apart[side].left){
+	all.left = apart[side].left < all.left ? apart[side].left : all.left;
+	all.right = apart[side].right > all.right ? apart[side].right : all.right;
+	all.top = apart[side].top < all.top ? apart[side].top : all.top;
+	all.bottom = apart[side].bottom > all.bottom ?
+	  apart[side].bottom : all.bottom;
+      }
+    }
+    for(j = all.top; j <= all.bottom; j++){
+      for(i = all.left; i <= all.right; i++){
+	place = (size_t)j * w->stride + i;
+	if(w->cells[place] != (w->apart[0][place] | w->apart[1][place])){
+	  return 1;
+	}
+      }
+    }
+    if(all.right < all.left || all.left < 2 || all.top < 2 ||
+       all.right >= w->stride - 2 || all.bottom >= w->stride - 2){
+      return 0;
+    }
+  }
+  return 0;
+}
+/**
+ * Join two groups. The least cell stays the root, so the names come
+ * out the same in whatever order the groups are joined.
+ *
+ * @param w Worker
+ * @param a Root of the first group
+ * @param b Root of the second group
+ */
+static void joinGroups(Worker *w, int a, int b){
+  if(a != b){
+    w->group[a > b ? a : b] = a < b ? a : b;
+  }
+}
+/**
+ * Find the group of a gathered cell, halving the path to it.
+ *
+ * @param w Worker
+ * @param k Cell
+ * @return The cell at the root of the group
+ */
+static int findGroup(Worker *w, int k){
+  while(w->group[k] != k){
+    w->group[k] = w->group[w->group[k]];
+    k = w->group[k];
+  }
+  return k;
+}
+/**
+ * Name one group of the gathered cells. It is put on a board of its
+ * own and stepped until its shape comes back, or for CENSUS_PHASES
+ * generations, keeping the least image of every phase on the way.
+ *
+ * @param w Worker, with the cells gathered and grouped
+ * @param n Number of cells gathered
+ * @param group Root of the group
+ */
+static void nameObject(Worker *w, int n, int group){
+  char code[CODE_LENGTH];
+  Box box, now, start;
+  size_t area;
+  int k, phase, period, population;
+  area = (size_t)w->stride * w->stride;
+  memset(w->cells, 0, area);
+  box.left = box.right = w->column[group];
+  box.top = box.bottom = w->row[group];
+  for(k = group + 1; k < n; k++){
+    if(w->group[k] == group){
+      box.left = w->column[k] < box.left ? w->column[k] : box.left;
+      box.right = w->column[k] > box.right ? w->column[k] : box.right;
+      box.top = w->row[k] < box.top ? w->row[k] : box.top;
+      box.bottom = w->row[k] > box.bottom ? w->row[k] : box.bottom;
+    }
+  }
+  population = 0;
+  for(k = group; k < n; k++){
+    if(w->group[k] == group){
+      w->cells[placeOf(w, &box, k)] = 1;
+      population++;
+    }
+  }
+  start.left = start.top = CENSUS_MARGIN;
+  start.right = box.right - box.left + CENSUS_MARGIN;
+  start.bottom = box.bottom - box.top + CENSUS_MARGIN;
+  now = start;
+  memcpy(w->first, w->cells, area);
+  w->best[0] = '\0';
+  period = 0;
+  for(phase = 1; phase <= CENSUS_PHASES; phase++){
+    leastImage(w, &now);
+    stepBoard(&w->cells, &w->next, w->stride, &now);
+    /* Dying out or reaching the margin, it was never a whole object */
+    if(now.right < now.left || now.left < 2 || now.top < 2 ||
+       now.right >= w->stride - 2 || now.bottom >= w->stride - 2){
+      break;
+    }
+    if(sameShape(w, &now, &start)){
+      period = phase;
+      break;
+    }
+  }
+  if(period == 0){
+    /* Only the first phase is certain to be the object's own */
+    memcpy(w->cells, w->first, area);
+    w->best[0] = '\0';
+    leastImage(w, &start);
+    strcpy(code, "zz");
+  }
+  else if(now.left != start.left || now.top != start.top){
+    sprintf(code, "xq%d", period);
+  }
+  else if(period > 1){
+    sprintf(code, "xp%d", period);
+  }
+  else{
+    sprintf(code, "xs%d", population);
+  }
+  sprintf(w->name, "%s_%s", code, w->best);
+}
+/**
+ * Step the cells on a board one generation, only within their box and
+ * one cell round it, and find their new box. The old cells are
+ * cleared before the boards swap, so the next board is always dead.
+ *
+ * @param cells Board, swapped with the next one
+ * @param next Dead board
+ * @param stride Side of the boards
+ * @param box Box round the cells, set to the new one
+ */
+static void stepBoard(unsigned char **cells, unsigned char **next,
+		      int stride, Box *box){
+  unsigned char *up, *row, *down, *out, *temp;
+  Box after;
+  int i, j, sum;
+  after.left = after.top = stride;
+  after.right = after.bottom = -1;
+  if(box->right < box->left){
+    *box = after;
+    return;
+  }
+  for(j = box->top - 1; j <= box->bottom + 1; j++){
+    up = *cells + (size_t)(j - 1) * stride;
+    row = up + stride;
+    down = row + stride;
+    out = *next + (size_t)j * stride;
+    for(i = box->left - 1; i <= box->right + 1; i++){
+      sum = up[i - 1] + up[i] + up[i + 1] + row[i - 1] + row[i + 1] +
+	down[i - 1] + down[i] + down[i + 1];
+      out[i] = ((row[i] ? lifeRule.survive : lifeRule.birth) >> sum) & 1;
+      if(out[i]){
+	after.left = i < after.left ? i : after.left;
+	after.right = i > after.right ? i : after.right;
+	after.top = j < after.top ? j : after.top;
+	after.bottom = j;
+      }
+    }
+  }
+  for(j = box->top; j <= box->bottom; j++){
+    memset(*cells + (size_t)j * stride + box->left, 0,
+	   box->right - box->left + 1);
+  }
+  temp = *cells;
+  *cells = *next;
+  *next = temp;
+  *box = after;
+}
+/**
+ * Whether an object has the shape it started with, wherever it is.
+ *
+ * @param w Worker, the object on its cells
+ * @param box Box round the object now
+ * @param start Box round the object at the start
+ * @return 1 if the shapes match, 0 otherwise
+ */
+static int sameShape(Worker *w, Box *box, Box *start){
+  int j;
+  if(box->right - box->left != start->right - start->left ||
+     box->bottom - box->top != start->bottom - start->top){
+    return 0;
+  }
+  for(j = 0; j <= box->bottom - box->top; j++){
+    if(memcmp(w->cells + (size_t)(box->top + j) * w->stride + box->left,
+	      w->first + (size_t)(start->top + j) * w->stride + start->left,
+	      box->right - box->left + 1) != 0){
+      return 0;
+    }
+  }
+  return 1;
+}
+/**
+ * Keep the least of an object's images, in any of the eight ways it
+ * can be turned or reflected, if it is less than the best so far.
+ * An image is the rows of the box in the pattern file's characters,
+ * split by '/'.
+ *
+ * @param w Worker, the object on its cells and the best image so far
+ * @param box Box round the object
+ */
+static void leastImage(Worker *w, Box *box){
+  int width, height, turn, flipx, flipy, c, r, u, v, k, across, down;
+  width = box->right - box->left + 1;
+  height = box->bottom - box->top + 1;
+  for(turn = 0; turn < 2; turn++){
+    across = turn ? height : width;
+    down = turn ? width : height;
+    for(flipx = 0; flipx < 2; flipx++){
+      for(flipy = 0; flipy < 2; flipy++){
+	k = 0;
+	for(r = 0; r < down; r++){
+	  for(c = 0; c < across; c++){
+	    u = turn ? r : c;
+	    v = turn ? c : r;
+	    u = flipx ? width - 1 - u : u;
+	    v = flipy ? height - 1 - v : v;
+	    w->image[k++] = w->cells[(size_t)(box->top + v) * w->stride +
+				     box->left + u] ? ALIVE : DEAD;
+	  }
+	  w->image[k++] = '/';
+	}
+	w->image[k - 1] = '\0';
+	if(w->best[0] == '\0' || strcmp(w->image, w->best) < 0){
+	  strcpy(w->best, w->image);
+	}
+      }
+    }
+  }
+}
+/**
+ * Count an object under its name, growing the table at half full.
+ *
+ * @param t Tally
+ * @param name Name, copied when it is new
+ * @param count Number found
+ */
+static void addKind(Tally *t, char *name, uint64_t count){
+  Kind *old;
+  size_t i, size;
+  uint64_t h;
+  if(2 * (t->used + 1) > t->size){
+    old = t->kinds;
+    size = t->size;
+    t->size = size > 0 ? 2 * size : CENSUS_TABLE;
+    t->kinds = (Kind *)calloc(t->size, sizeof(Kind));
+    if(t->kinds == NULL){
+      printf("Cannot Allocate Census\n");
+      exit(2);
+    }
+    for(i = 0; i < size; i++){
+      if(old[i].name != NULL){
+	h = old[i].hash & (t->size - 1);
+	for(; t->kinds[h].name != NULL; h = (h + 1) & (t->size - 1));
+	t->kinds[h] = old[i];
+      }
+    }
+    free(old);
+  }
+  h = hashName(name);
+  for(i = h & (t->size - 1); t->kinds[i].name != NULL;
+      i = (i + 1) & (t->size - 1)){
+    if(t->kinds[i].hash == h && strcmp(t->kinds[i].name, name) == 0){
+      t->kinds[i].count += count;
+      return;
+    }
+  }
+  t->kinds[i].name = (char *)malloc(strlen(name) + 1);
+  if(t->kinds[i].name == NULL){
+    printf("Cannot Allocate Census\n");
+    exit(2);
+  }
+  strcpy(t->kinds[i].name, name);
+  t->kinds[i].hash = h;
+  t->kinds[i].count = count;
+  t->used++;
+}
+/**
+ * List the kinds of a tally, most common first.
+ *
+ * @param t Tally
+ * @param n Set to the number of kinds
+ * @return The kinds, to be freed by the caller
+ */
+static Kind **sortKinds(Tally *t, size_t *n){
+  Kind **sorted;
+  size_t k;
+  sorted = (Kind **)malloc(sizeof(Kind *) * (t->used + 1));
+  if(sorted == NULL){
+    printf("Cannot Allocate Census\n");
+    exit(2);
+  }
+  for(k = 0, *n = 0; k < t->size; k++){
+    if(t->kinds[k].name != NULL){
+      sorted[(*n)++] = &t->kinds[k];
+    }
+  }
+  qsort(sorted, *n, sizeof(Kind *), compareKinds);
+  return sorted;
+}
+/**
+ * Order kinds by count, most first, then by name.
+ *
+ * @param a First kind
+ * @param b Second kind
+ * @return Negative, zero or positive as for qsort
+ */
+static int compareKinds(const void *a, const void *b){
+  const Kind *p, *q;
+  p = *(const Kind * const *)a;
+  q = *(const Kind * const *)b;
+  if(p->count != q->count){
+    return p->count > q->count ? -1 : 1;
+  }
+  return strcmp(p->name, q->name);
+}
+/**
+ * FNV-1a hash of a name.
+ *
+ * @param name Name
+ * @return Hash
+ */
+static uint64_t hashName(char *name){
+  uint64_t h;
+  h = FNV_OFFSET;
+  for(; *name != '\0'; name++){
+    h = (h ^ (unsigned char)*name) * FNV_PRIME;
+  }
+  return h;
+}
+/**
+ * Next number of a SplitMix64 sequence.
+ *
+ * @param state Sequence, advanced
+ * @return Next number
+ */
+static uint64_t splitMix(uint64_t *state){
+  uint64_t z;
+  z = (*state += SPLITMIX_GAMMA);
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+  return z ^ (z >> 31);
+}
@@ -0,0 +1,128 @@
+/**
+ * @file changes.c
+ * @author YAN SUN
+ * @version 1.0
+ *
+ * @section DESCRIPTION
+ * Changed squares marked while stepping.
+ * An engine created while lifeChanges is set keeps, for every row,
+ * a bit for each CHANGE_TILE columns that changed since the squares
+ * were last asked for. The row is marked by the thread that wrote it,
+ * straight after it is written and still in the cache, so nothing is
+ * shared between the bands and the board is never compared again.
+ * Asking for the squares only ORs the rows' bits together, a word for
+ * every 64 squares of a row, and clears them for the next time.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "life.h"
+
+#define WORD_BITS 64
+
+/* Set to have engines mark the squares their rows change */
+int lifeChanges = 0;
+
+/**
+ * Words of marks a row of a board has.
+ *
+ * @param x Number of columns
+ * @return Words a row
+ */
+int changeWords(int x){
+  return ((x + CHANGE_TILE - 1) / CHANGE_TILE + WORD_BITS - 1) / WORD_BITS;
+}
+/**
+ * Allocate the marks of a board's rows, if lifeChanges is set.
+ *
+ * @param x Number of columns
+ * @param y Number of rows
+ * @return The marks, all clear, or NULL when not marking
+ */
+uint64_t *newChanges(int x, int y){
+  uint64_t *marks;
+  if(!lifeChanges){
+    return NULL;
+  }
+  marks = (uint64_t *)calloc((size_t)changeWords(x) * y, sizeof(uint64_t));
+  if(marks == NULL){
+    printf("Cannot Allocate Engine\n");
+    exit(2);
+  }
+  return marks;
+}
+/**
+ * Mark the squares of a row of one byte a cell that differ from the
+ * row before.
+ *
+ * @param now Row in the new generation
+ * @param before Row in the generation before
+ * @param x Cells in the row
+ * @param marks Marks of the row
+ */
+void markBytes(const unsigned char *now, const unsigned char *before,
+	       int x, uint64_t *marks){
+  int i, t;
+  for(i = 0, t = 0; i < x; i += CHANGE_TILE, t++){
+    if(memcmp(now + i, before + i,
+	      x - i < CHANGE_TILE ? x - i : CHANGE_TILE) != 0){
+      marks[t / WORD_BITS] |= 1ULL << (t % WORD_BITS);
+    }
+  }
+}
+/**
+ * Mark the squares of a packed row that differ from the row before.
+ * A word is one row of a square, since both are 64 cells wide.
+ *
+ * @param now Row in the new generation
+ * @param before Row in the generation before
+ * @param words Words in the row
+ * @param lastMask Cells of the last word on the board, as the word
+ * before may hold a wrapped cell past the edge
+ * @param marks Marks of the row
+ */
+void markWords(const uint64_t *now, const uint64_t *before, int words,
+	       uint64_t lastMask, uint64_t *marks){
+  int k;
+  for(k = 0; k < words - 1; k++){
+    if(now[k] != before[k]){
+      marks[k / WORD_BITS] |= 1ULL << (k % WORD_BITS);
+    }
+  }
+  if(now[k] != (before[k] & lastMask)){
+    marks[k / WORD_BITS] |= 1ULL << (k % WORD_BITS);
+  }
+}
+/**
+ * Set the squares the rows marked, then clear the marks. Without
+ * marks every square is set, as the engine cannot tell.
+ *
+ * @param marks Marks of every row, NULL if the engine kept none
+ * @param x Number of columns
+ * @param y Number of rows
+ * @param tiles Squares, row by row, set to 1 where cells changed
+ */
+void sumChanges(uint64_t *marks, int x, int y, unsigned char *tiles){
+  uint64_t bits;
+  int words, tilesX, j, k, end, t;
+  tilesX = (x + CHANGE_TILE - 1) / CHANGE_TILE;
+  if(marks == NULL){
+    memset(tiles, 1, (size_t)tilesX * ((y + CHANGE_TILE - 1) / CHANGE_TILE));
+    return;
+  }
+  words = changeWords(x);
+  for(j = 0; j < y; j = end){
+    end = j + CHANGE_TILE < y ? j + CHANGE_TILE : y;
+    for(k = 0; k < words; k++){
+      bits = 0;
+      for(t = j; t < end; t++){
+	bits |= marks[(size_t)t * words + k];
+	marks[(size_t)t * words + k] = 0;
+      }
+      for(; bits != 0; bits &= bits - 1){
+	tiles[(j / CHANGE_TILE) * tilesX + k * WORD_BITS +
+	      __builtin_ctzll(bits)] = 1;
+      }
+    }
+  }
+}
@@ -0,0 +1,357 @@
+/**
+ * @file checkpoint.c
+ * @author YAN SUN
+ * @version 1.0
+ *
+ * @section DESCRIPTION
+ * Binary checkpoints of a run.
+ * A checkpoint is a fixed header (size, rule, generation) followed by
+ * the cells packed 64 to a word, each row padded to whole words, bit
+ * i of a word being cell i like the swar engine. The topology of the
+ * edges is kept in the flags. The words can be
+ * compressed as runs: a count of empty words, a count of words kept
+ * as they are, then those words, over and over.
+ * A checkpoint is written to a temporary file and renamed over the
+ * old one, so a crash never leaves half a checkpoint. It is read back
+ * through mmap and streamed into the engine straight from the mapped
+ * pages, so many runs can start from one file without copying it.
+ * Numbers are stored in the machine's own byte order.
+ */
+#define _POSIX_C_SOURCE 200112L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "life.h"
+
+#define CHECKPOINT_MAGIC "LIFESNAP"
+#define CHECKPOINT_VERSION 1
+#define CHECKPOINT_COMPRESSED 1
+/* The topology is in the flags' next two bits */
+#define CHECKPOINT_TOPOLOGY 1
+#define WORD_BITS 64
+#define NAME_LENGTH 4096
+/* Most empty words one run can count */
+#define RUN_MAXIMUM 0xFFFFFFFFULL
+
+struct header{
+  char magic[8];
+  uint32_t version;
+  uint32_t flags;
+  uint32_t x;
+  uint32_t y;
+  uint32_t birth;
+  uint32_t survive;
+  uint64_t generation;
+  /* Words that follow the header */
+  uint64_t words;
+};
+typedef struct header Header;
+
+/* The run of words being compressed */
+struct packer{
+  FILE *file;
+  uint64_t empty;
+  int kept;
+  uint64_t buffer[WORD_BITS];
+  /* Words written so far */
+  uint64_t written;
+};
+typedef struct packer Packer;
+
+/* Where the unpacked cells go, with the run of live cells so far */
+struct unpacker{
+  void *state;
+  void (*live)(void *state, int i, int j, int n);
+  int x;
+  int words;
+  uint64_t word;
+  int start;
+};
+typedef struct unpacker Unpacker;
+
+static void packRow(Grid *g, int j, uint64_t *row);
+static int packWords(Packer *p, uint64_t *words, int count);
+static int endRun(Packer *p);
+static void unpackWord(Unpacker *u, uint64_t bits);
+
+/**
+ * Whether a file is a checkpoint.
+ *
+ * @param name File name
+ * @return 1 if it starts like one, 0 otherwise
+ */
+int isCheckpoint(char *name){
+  FILE *file;
+  char magic[8];
+  int found;
+  file = fopen(name, "rb");
+  if(file == NULL){
+    return 0;
+  }
+  found = fread(magic, 1, 8, file) == 8 &&
+    memcmp(magic, CHECKPOINT_MAGIC, 8) == 0;
+  fclose(file);
+  return found;
+}
+/**
+ * Write a checkpoint of a board.
+ *
+ * @param name File name
+ * @param g Board
+ * @param generation Generation of the board
+ * @param compress 1 to store the words as runs
+ * @return 0 on success, 1 if the file cannot be written
+ */
+int saveCheckpoint(char *name, Grid *g, uint64_t generation, int compress){
+  char temp[NAME_LENGTH];
+  Header h;
+  Packer p;
+  FILE *file;
+  uint64_t *row;
+  int j, words, failed;
+  words = (g->x + WORD_BITS - 1) / WORD_BITS;
+  row = (uint64_t *)malloc(sizeof(uint64_t) * words);
+  if(row == NULL){
+    printf("Cannot Allocate Checkpoint\n");
+    exit(2);
+  }
+  if(snprintf(temp, NAME_LENGTH, "%s.tmp", name) >= NAME_LENGTH ||
+     (file = fopen(temp, "wb")) == NULL){
+    printf("Could not write checkpoint (%s). \n", name);
+    free(row);
+    return 1;
+  }
+  memset(&h, 0, sizeof(h));
+  memcpy(h.magic, CHECKPOINT_MAGIC, 8);
+  h.version = CHECKPOINT_VERSION;
+  h.flags = (compress ? CHECKPOINT_COMPRESSED : 0) |
+    lifeTopology << CHECKPOINT_TOPOLOGY;
+  h.x = g->x;
+  h.y = g->y;
+  h.birth = lifeRule.birth;
+  h.survive = lifeRule.survive;
+  h.generation = generation;
+  /* The length is filled in once the words are written */
+  failed = fwrite(&h, sizeof(h), 1, file) != 1;
+  p.file = file;
+  p.empty = 0;
+  p.kept = 0;
+  p.written = 0;
+  for(j = 0; j < g->y && !failed; j++){
+    packRow(g, j, row);
+    if(compress){
+      failed = packWords(&p, row, words);
+    }
+    else{
+      failed = fwrite(row, sizeof(uint64_t), words, file) != (size_t)words;
+    }
+  }
+  if(compress && !failed){
+    failed = endRun(&p);
+  }
+  h.words = compress ? p.written : (uint64_t)words * g->y;
+  failed = failed || fseek(file, 0, SEEK_SET) != 0 ||
+    fwrite(&h, sizeof(h), 1, file) != 1;
+  failed = fclose(file) != 0 || failed;
+  free(row);
+  if(failed || rename(temp, name) != 0){
+    printf("Could not write checkpoint (%s). \n", name);
+    remove(temp);
+    return 1;
+  }
+  return 0;
+}
+/**
+ * Pack one row of a board into words.
+ *
+ * @param g Board
+ * @param j Row
+ * @param row Words of the row
+ */
+static void packRow(Grid *g, int j, uint64_t *row){
+  char *cells;
+  int i;
+  cells = g->cells + (size_t)j * g->x;
+  memset(row, 0, sizeof(uint64_t) * ((g->x + WORD_BITS - 1) / WORD_BITS));
+  for(i = 0; i < g->x; i++){
+    if(cells[i] == ALIVE){
+      row[i / WORD_BITS] |= 1ULL << (i % WORD_BITS);
+    }
+  }
+}
+/**
+ * Add words to the runs being written. A run is only written once it
+ * ends, so it can carry on from one row into the next.
+ *
+ * @param p Packer
+ * @param words Words
+ * @param count Number of words
+ * @return 0 on success, 1 on a write error
+ */
+static int packWords(Packer *p, uint64_t *words, int count){
+  int i;
+  for(i = 0; i < count; i++){
+    /* An empty word after kept ones, or a full buffer, ends the run */
+    if((words[i] == 0 && p->kept > 0) || p->kept == WORD_BITS ||
+       p->empty == RUN_MAXIMUM){
+      if(endRun(p)){
+	return 1;
+      }
+    }
+    if(words[i] == 0 && p->kept == 0){
+      p->empty++;
+    }
+    else{
+      p->buffer[p->kept++] = words[i];
+    }
+  }
+  return 0;
+}
+/**
+ * Write the run being packed: its counts in one word, then the words
+ * kept.
+ *
+ * @param p Packer
+ * @return 0 on success, 1 on a write error
+ */
+static int endRun(Packer *p){
+  uint64_t record;
+  if(p->empty == 0 && p->kept == 0){
+    return 0;
+  }
+  record = p->empty | (uint64_t)p->kept << 32;
+  if(fwrite(&record, sizeof(uint64_t), 1, p->file) != 1 ||
+     fwrite(p->buffer, sizeof(uint64_t), p->kept, p->file) != (size_t)p->kept){
+    return 1;
+  }
+  p->written += 1 + p->kept;
+  p->empty = 0;
+  p->kept = 0;
+  return 0;
+}
+/**
+ * Map a checkpoint and stream its cells into a new engine state.
+ * The rule and topology are taken from the checkpoint unless they
+ * were given on the command line.
+ *
+ * @param name File name
+ * @param blank Create a state of x by y dead cells
+ * @param live Make n cells from cell i of row j alive
+ * @param x Set to the number of columns
+ * @param y Set to the number of rows
+ * @param generation Set to the generation of the checkpoint
+ * @return The state, NULL if the file cannot be read
+ */
+void *loadCheckpoint(char *name, void *(*blank)(int x, int y),
+		     void (*live)(void *state, int i, int j, int n),
+		     int *x, int *y, uint64_t *generation){
+  struct stat info;
+  Header *h;
+  Unpacker u;
+  char rule[RULE_LENGTH];
+  Rule saved;
+  uint64_t *words, record, n, k, total;
+  void *map;
+  int fd;
+  fd = open(name, O_RDONLY);
+  if(fd < 0 || fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(Header)){
+    printf("Could not open checkpoint (%s). \n", name);
+    if(fd >= 0){
+      close(fd);
+    }
+    return NULL;
+  }
+  map = mmap(NULL, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if(map == MAP_FAILED){
+    printf("Could not map checkpoint (%s). \n", name);
+    return NULL;
+  }
+  h = (Header *)map;
+  words = (uint64_t *)(h + 1);
+  if(memcmp(h->magic, CHECKPOINT_MAGIC, 8) != 0 ||
+     h->version != CHECKPOINT_VERSION || h->x < 1 || h->y < 1 ||
+     ((h->flags >> CHECKPOINT_TOPOLOGY) & 3) > TOPOLOGY_KLEIN ||
+     h->words > (info.st_size - sizeof(Header)) / sizeof(uint64_t) ||
+     (!(h->flags & CHECKPOINT_COMPRESSED) &&
+      h->words != (uint64_t)((h->x + WORD_BITS - 1) / WORD_BITS) * h->y)){
+    printf("Could not read checkpoint (%s). \n", name);
+    munmap(map, info.st_size);
+    return NULL;
+  }
+  fprintf(stderr, "Checkpoint (%s) opened at generation %llu. \n", name,
+	  (unsigned long long)h->generation);
+  saved.birth = h->birth;
+  saved.survive = h->survive;
+  formatRule(&saved, rule);
+  patternRule(rule);
+  patternTopology((h->flags >> CHECKPOINT_TOPOLOGY) & 3);
+  *x = h->x;
+  *y = h->y;
+  *generation = h->generation;
+  u.state = blank(h->x, h->y);
+  u.live = live;
+  u.x = h->x;
+  u.words = (h->x + WORD_BITS - 1) / WORD_BITS;
+  u.word = 0;
+  u.start = -1;
+  total = (uint64_t)u.words * h->y;
+  if(h->flags & CHECKPOINT_COMPRESSED){
+    for(n = 0; n < h->words && u.word < total; ){
+      record = words[n++];
+      for(k = 0; k < (record & 0xFFFFFFFFULL) && u.word < total; k++){
+	unpackWord(&u, 0);
+      }
+      for(k = 0; k < record >> 32 && n < h->words && u.word < total; k++){
+	unpackWord(&u, words[n++]);
+      }
+    }
+  }
+  else{
+    for(n = 0; n < total; n++){
+      unpackWord(&u, words[n]);
+    }
+  }
+  munmap(map, info.st_size);
+  fprintf(stderr, "Row: %d Column: %d \n", *x, *y);
+  return u.state;
+}
+/**
+ * Pass the live runs of the next word on to the engine.
+ * A run is held open until it ends, so it may cross words but never
+ * a row.
+ *
+ * @param u Unpacker
+ * @param bits Word
+ */
+static void unpackWord(Unpacker *u, uint64_t bits){
+  int j, k, i, b, end;
+  j = (int)(u->word / u->words);
+  k = (int)(u->word % u->words);
+  end = k == u->words - 1 ? u->x - k * WORD_BITS : WORD_BITS;
+  /* Nothing to do for an empty word outside a run */
+  if(bits == 0 && u->start < 0){
+    end = 0;
+  }
+  for(b = 0; b < end; b++){
+    i = k * WORD_BITS + b;
+    if((bits >> b) & 1){
+      if(u->start < 0){
+	u->start = i;
+      }
+    }
+    else if(u->start >= 0){
+      u->live(u->state, u->start, j, i - u->start);
+      u->start = -1;
+    }
+  }
+  if(k == u->words - 1 && u->start >= 0){
+    u->live(u->state, u->start, j, u->x - u->start);
+    u->start = -1;
+  }
+  u->word++;
+}
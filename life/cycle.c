@@ -0,0 +1,270 @@
+/**
+ * @file cycle.c
+ * @author YAN SUN
+ * @version 1.0
+ *
+ * @section DESCRIPTION
+ * Cycle detection with fast-forward.
+ * Every generation of a run is hashed and kept in a rolling history
+ * of the last HISTORY_LENGTH generations. The first generation whose
+ * hash is already in the history closes a cycle: the earlier one is
+ * where the cycle starts and the distance between them its period.
+ * From then on the board only repeats, so the rest of the run is cut
+ * down to less than one period and never simulated.
+ * Ships can be looked for too, by hashing the live cells relative to
+ * their bounding box: the same shape further along is a translation.
+ * A ship on a bounded board will reach the edge, so it is reported
+ * but not skipped. Only a bounded engine's board is the whole pattern,
+ * so unbounded engines cannot be watched this way.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "life.h"
+
+#define HISTORY_LENGTH 1024
+#define HISTORY_TABLE (4 * HISTORY_LENGTH)
+#define HASH_MULTIPLIER 0x9E3779B97F4A7C15ULL
+
+/* One generation's hash and where its shape was */
+struct entry{
+  uint64_t hash;
+  uint64_t generation;
+  int left;
+  int top;
+  int used;
+};
+typedef struct entry Entry;
+
+/* The last generations in order, and an open-addressed table of them
+   rebuilt after every HISTORY_LENGTH additions */
+struct history{
+  Entry ring[HISTORY_LENGTH];
+  Entry table[HISTORY_TABLE];
+  int added;
+};
+typedef struct history History;
+
+static void advanceOne(Engine *engine, void *state);
+static Entry *findEntry(History *h, uint64_t hash);
+static void addEntry(History *h, Entry *e);
+static void placeEntry(History *h, Entry *e);
+static uint64_t boardHash(Grid *g);
+static uint64_t shapeHash(Grid *g, int *left, int *top);
+static uint64_t hashRun(uint64_t h, const char *cells, size_t n);
+
+/**
+ * Run a bounded engine a number of generations, watching for a cycle.
+ * Once one is found the run skips straight to the last generation.
+ *
+ * @param engine Engine, bounded
+ * @param state Engine state, advanced by the number of generations
+ * @param x Number of columns
+ * @param y Number of rows
+ * @param generations Number of generations
+ * @param ships 1 to look for ships as well
+ * @param cycle Set to the cycle found, period 0 if none
+ * @return Number of generations actually simulated
+ */
+uint64_t runCycles(Engine *engine, void *state, int x, int y,
+		   uint64_t generations, int ships, Cycle *cycle){
+  History *h;
+  Grid *g;
+  Entry e, *seen;
+  uint64_t n, rest;
+  h = (History *)calloc(1, sizeof(History));
+  if(h == NULL){
+    printf("Cannot Allocate History\n");
+    exit(2);
+  }
+  g = allocateGrid(x, y);
+  cycle->onset = 0;
+  cycle->period = 0;
+  cycle->dx = 0;
+  cycle->dy = 0;
+  e.left = 0;
+  e.top = 0;
+  e.used = 1;
+  for(n = 0; ; n++){
+    engine->store(state, g);
+    e.hash = ships ? shapeHash(g, &e.left, &e.top) : boardHash(g);
+    e.generation = n;
+    seen = findEntry(h, e.hash);
+    if(seen != NULL && n - seen->generation <= HISTORY_LENGTH){
+      if(seen->left == e.left && seen->top == e.top){
+	cycle->onset = seen->generation;
+	cycle->period = n - seen->generation;
+	cycle->dx = 0;
+	cycle->dy = 0;
+	break;
+      }
+      if(cycle->period == 0){
+	cycle->onset = seen->generation;
+	cycle->period = n - seen->generation;
+	cycle->dx = e.left - seen->left;
+	cycle->dy = e.top - seen->top;
+      }
+    }
+    if(n == generations){
+      break;
+    }
+    addEntry(h, &e);
+    advanceOne(engine, state);
+  }
+  if(n < generations){
+    /* Whole periods change nothing, only the part of one left over */
+    for(rest = (generations - n) % cycle->period; rest > 0; rest--){
+      advanceOne(engine, state);
+      n++;
+    }
+  }
+  free(h);
+  freeGrid(g);
+  return n;
+}
+/**
+ * Advance an engine exactly one generation.
+ *
+ * @param engine Engine
+ * @param state Engine state
+ */
+static void advanceOne(Engine *engine, void *state){
+  if(engine->jump != NULL){
+    engine->jump(state, 1);
+  }
+  else{
+    engine->step(state);
+  }
+}
+/**
+ * Look a hash up in the history.
+ *
+ * @param h History
+ * @param hash Hash
+ * @return The latest generation with the hash, NULL if there is none
+ */
+static Entry *findEntry(History *h, uint64_t hash){
+  size_t i;
+  for(i = hash % HISTORY_TABLE; h->table[i].used; i = (i + 1) % HISTORY_TABLE){
+    if(h->table[i].hash == hash){
+      return &h->table[i];
+    }
+  }
+  return NULL;
+}
+/**
+ * Add a generation to the history. The table keeps up to twice
+ * HISTORY_LENGTH entries before it is rebuilt from the ring, so it
+ * stays at most half full.
+ *
+ * @param h History
+ * @param e Generation
+ */
+static void addEntry(History *h, Entry *e){
+  int i;
+  h->ring[e->generation % HISTORY_LENGTH] = *e;
+  if(++h->added == HISTORY_LENGTH){
+    memset(h->table, 0, sizeof(h->table));
+    for(i = 0; i < HISTORY_LENGTH; i++){
+      if(h->ring[i].used){
+	placeEntry(h, &h->ring[i]);
+      }
+    }
+    h->added = 0;
+  }
+  else{
+    placeEntry(h, e);
+  }
+}
+/**
+ * Put an entry in the table, over an older one with the same hash.
+ *
+ * @param h History
+ * @param e Entry
+ */
+static void placeEntry(History *h, Entry *e){
+  Entry *slot;
+  size_t i;
+  for(i = e->hash % HISTORY_TABLE; h->table[i].used &&
+	h->table[i].hash != e->hash; i = (i + 1) % HISTORY_TABLE);
+  slot = &h->table[i];
+  if(!slot->used || slot->generation < e->generation){
+    *slot = *e;
+  }
+}
+/**
+ * Hash of the whole board.
+ *
+ * @param g Board
+ * @return Hash
+ */
+static uint64_t boardHash(Grid *g){
+  return hashRun(HASH_MULTIPLIER, g->cells, (size_t)g->x * g->y);
+}
+/**
+ * Hash of the live cells relative to their bounding box,
+ * the same wherever on the board the shape is.
+ *
+ * @param g Board
+ * @param left Set to the box's first column
+ * @param top Set to the box's first row
+ * @return Hash
+ */
+static uint64_t shapeHash(Grid *g, int *left, int *top){
+  char *row, *first;
+  uint64_t h;
+  int i, j, right, bottom;
+  *left = g->x;
+  *top = g->y;
+  right = bottom = -1;
+  for(j = 0; j < g->y; j++){
+    row = g->cells + (size_t)j * g->x;
+    first = (char *)memchr(row, ALIVE, g->x);
+    if(first == NULL){
+      continue;
+    }
+    if(*top == g->y){
+      *top = j;
+    }
+    bottom = j;
+    if(first - row < *left){
+      *left = (int)(first - row);
+    }
+    for(i = g->x - 1; row[i] != ALIVE; i--);
+    if(i > right){
+      right = i;
+    }
+  }
+  if(bottom < 0){
+    *left = *top = 0;
+    return HASH_MULTIPLIER;
+  }
+  h = HASH_MULTIPLIER;
+  h = (h ^ (uint64_t)(right - *left)) * HASH_MULTIPLIER;
+  h = (h ^ (uint64_t)(bottom - *top)) * HASH_MULTIPLIER;
+  for(j = *top; j <= bottom; j++){
+    h = hashRun(h, g->cells + (size_t)j * g->x + *left, right - *left + 1);
+  }
+  return h;
+}
+/**
+ * Mix a run of cells into a hash, eight at a time.
+ *
+ * @param h Hash so far
+ * @param cells Cells
+ * @param n Number of cells
+ * @return Hash
+ */
+static uint64_t hashRun(uint64_t h, const char *cells, size_t n){
+  uint64_t word;
+  size_t i;
+  for(i = 0; i + 8 <= n; i += 8){
+    memcpy(&word, cells + i, 8);
+    h = (h ^ word) * HASH_MULTIPLIER;
+    h ^= h >> 29;
+  }
+  for(; i < n; i++){
+    h = (h ^ (unsigned char)cells[i]) * HASH_MULTIPLIER;
+  }
+  return h ^ (h >> 32);
+}
@@ -0,0 +1,81 @@
+/**
+ * @file grid.c
+ * @author YAN SUN
+ * @version 1.0
+ *
+ * @section DESCRIPTION
+ * Heap-allocated boards of any size.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "life.h"
+
+static void *blankGrid(int x, int y);
+static void liveGrid(void *state, int i, int j, int n);
+
+/**
+ * Allocate an x by y grid with every cell dead.
+ * Exit when there is not enough memory.
+ *
+ * @param x Number of columns
+ * @param y Number of rows
+ * @return The new grid
+ */
+Grid *allocateGrid(int x, int y){
+  Grid *g;
+  g = (Grid *)malloc(sizeof(Grid));
+  if(g == NULL){
+    printf("Cannot Allocate Grid\n");
+    exit(2);
+  }
+  g->x = x;
+  g->y = y;
+  g->cells = (char *)malloc((size_t)x * y);
+  if(g->cells == NULL){
+    printf("Cannot Allocate Grid of %d x %d\n", x, y);
+    exit(2);
+  }
+  memset(g->cells, DEAD, (size_t)x * y);
+  return g;
+}
+/**
+ * Free a grid.
+ *
+ * @param g Grid
+ */
+void freeGrid(Grid *g){
+  free(g->cells);
+  free(g);
+}
+/**
+ * Load a pattern file of any format into a grid.
+ *
+ * @param name File name
+ * @return The grid, NULL if the file cannot be read
+ */
+Grid *loadGrid(char *name){
+  int x, y;
+  return (Grid *)loadPattern(name, blankGrid, liveGrid, &x, &y);
+}
+/**
+ * Allocate a grid for the pattern loader.
+ *
+ * @param x Number of columns
+ * @param y Number of rows
+ * @return The new grid
+ */
+static void *blankGrid(int x, int y){
+  return allocateGrid(x, y);
+}
+/**
+ * Make a run of cells of a grid alive.
+ *
+ * @param state Grid
+ * @param i First column of the run
+ * @param j Row
+ * @param n Length of the run
+ */
+static void liveGrid(void *state, int i, int j, int n){
+  memset(&CELL((Grid *)state, i, j), ALIVE, n);
+}
@@ -0,0 +1,883 @@
+/**
+ * @file hashlife.c
+ * @author YAN SUN
+ * @version 1.0
+ *
+ * @section DESCRIPTION
+ * HashLife engine for very many generations.
+ * The plane is a quadtree of nodes. A node of level n is a 2^n square
+ * made of four nodes of level n - 1, the leaves are 8x8 blocks of
+ * bits at level 3. Nodes are hash-consed, so equal squares are the
+ * same node however often they appear in space or time.
+ * A node remembers its centre 2^(n-1) square advanced 2^(n-2)
+ * generations, and for the last smaller step 2^j, so repeating
+ * patterns are only calculated once and a single step can jump
+ * 2^j generations.
+ *
+ * Like the "plane" engine the universe has no edge, store copies out
+ * the window of the loaded board. When the nodes outgrow the memory
+ * limit, the ones no longer in the tree are collected between jumps.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "life.h"
+#include "swar.h"
+
+#define LEAF_LEVEL 3
+#define LEAF_SIZE 8
+#define LEAF_ROW 0xFFULL
+#define MAX_LEVEL 62
+#define NODE_BLOCK 4096
+#define FIRST_BUCKETS 4096
+#define MEGABYTE (1024 * 1024)
+#define DEFAULT_MEGABYTES 512
+
+struct node{
+  struct node *nw;
+  struct node *ne;
+  struct node *sw;
+  struct node *se;
+  /* Centre advanced 2^(level-2) generations, NULL until needed */
+  struct node *result;
+  /* Centre advanced 2^step generations for the last smaller step */
+  struct node *partial;
+  struct node *chain;
+  /* Leaf cells, bit 8r + i is cell i of row r */
+  uint64_t bits;
+  uint64_t population;
+  int level;
+  int step;
+  int mark;
+};
+typedef struct node Node;
+
+/* A non-empty leaf read by the loader, before the tree is built */
+struct pending{
+  /* Leaf column and row, bits interleaved */
+  uint64_t key;
+  uint64_t bits;
+};
+typedef struct pending Pending;
+
+/* Nodes are allocated a block at a time */
+struct block{
+  struct block *next;
+  Node nodes[NODE_BLOCK];
+};
+typedef struct block Block;
+
+struct hash{
+  int x;
+  int y;
+  Node *root;
+  /* Board position of the root's top left corner */
+  int64_t left;
+  int64_t top;
+  Node **table;
+  size_t buckets;
+  size_t count;
+  Node *free;
+  Block *blocks;
+  Node *empty[MAX_LEVEL + 1];
+  int speed;
+  size_t limit;
+  RuleTerms terms;
+  /* Loader's band of LEAF_SIZE rows, packed 64 cells a word */
+  uint64_t *band;
+  int bandWords;
+  int bandRow;
+  Pending *pending;
+  size_t pendingCount;
+  size_t pendingSize;
+};
+typedef struct hash Hash;
+
+static void *hashCreate(Grid *g);
+static void *hashBlank(int x, int y);
+static Hash *newHash(int x, int y);
+static void hashLive(void *state, int i, int j, int n);
+static void flushBand(Hash *s);
+static void settle(Hash *s);
+static int comparePending(const void *a, const void *b);
+static uint64_t interleave(uint32_t column, uint32_t row);
+static Node *buildPending(Hash *s, Pending *list, size_t count, int level);
+static int rootLevel(int x, int y);
+static void hashStep(void *state);
+static void hashJump(void *state, uint64_t generations);
+static void hashStore(void *state, Grid *g);
+static void hashDestroy(void *state);
+static Node *buildNode(Hash *s, Grid *g, int level, int64_t left, int64_t top);
+static void advance(Hash *s, int step);
+static void expand(Hash *s);
+static Node *successor(Hash *s, Node *n, int step);
+static Node *remember(Node *n, int step, Node *result);
+static Node *leafStep(Hash *s, Node *n, int step);
+static Node *centre(Hash *s, Node *n);
+static Node *findLeaf(Hash *s, uint64_t bits);
+static Node *join(Hash *s, Node *nw, Node *ne, Node *sw, Node *se);
+static Node *emptyNode(Hash *s, int level);
+static Node *newNode(Hash *s);
+static size_t nodeHash(Node *nw, Node *ne, Node *sw, Node *se, uint64_t bits);
+static void growTable(Hash *s);
+static void collect(Hash *s);
+static void markNode(Node *n);
+static void storeNode(Node *n, int64_t left, int64_t top, Grid *g);
+
+Engine hashEngine = {"hashlife", hashCreate, hashStep,
+		     hashStore, hashDestroy, hashJump,
+		     hashBlank, hashLive, NULL, NULL, NULL, 0, 0};
+
+/* Settings from hashInit, copied into each new engine */
+static int hashSpeed = 0;
+static size_t hashLimit = (size_t)DEFAULT_MEGABYTES * MEGABYTE;
+
+/**
+ * Set up the HashLife engines created from now on.
+ *
+ * @param speed Each step advances 2^speed generations
+ * @param megabytes Memory for nodes before collecting, 0 for the default
+ */
+void hashInit(int speed, size_t megabytes){
+  if(speed < 0 || speed > MAX_LEVEL - 3){
+    printf("Step power must be from 0 to %d\n", MAX_LEVEL - 3);
+    exit(1);
+  }
+  hashSpeed = speed;
+  hashLimit = (megabytes ? megabytes : DEFAULT_MEGABYTES) * (size_t)MEGABYTE;
+}
+/**
+ * Build the quadtree of the grid.
+ *
+ * @param g Grid
+ * @return The new engine state
+ */
+static void *hashCreate(Grid *g){
+  Hash *s;
+  s = newHash(g->x, g->y);
+  s->root = buildNode(s, g, rootLevel(g->x, g->y), 0, 0);
+  return s;
+}
+/**
+ * Create an engine for the loader to fill.
+ * The loader's rows are packed into a band of LEAF_SIZE rows, and the
+ * band's non-empty leaves kept, so the tree is only built once the
+ * engine is first used.
+ *
+ * @param x Number of columns
+ * @param y Number of rows
+ * @return The new engine state
+ */
+static void *hashBlank(int x, int y){
+  Hash *s;
+  s = newHash(x, y);
+  s->bandWords = (x + 63) / 64;
+  s->band = (uint64_t *)calloc((size_t)s->bandWords * LEAF_SIZE, sizeof(uint64_t));
+  if(s->band == NULL){
+    printf("Cannot Allocate Engine\n");
+    exit(2);
+  }
+  return s;
+}
+/**
+ * Create an engine state with an empty node table and no root.
+ *
+ * @param x Number of columns
+ * @param y Number of rows
+ * @return The new engine state
+ */
+static Hash *newHash(int x, int y){
+  Hash *s;
+  s = (Hash *)calloc(1, sizeof(Hash));
+  if(s == NULL){
+    printf("Cannot Allocate Engine\n");
+    exit(2);
+  }
+  s->x = x;
+  s->y = y;
+  s->speed = hashSpeed;
+  s->limit = hashLimit;
+  compileTerms(&lifeRule, &s->terms);
+  s->buckets = FIRST_BUCKETS;
+  s->table = (Node **)calloc(s->buckets, sizeof(Node *));
+  if(s->table == NULL){
+    printf("Cannot Allocate Engine\n");
+    exit(2);
+  }
+  return s;
+}
+/**
+ * Level of the smallest root that holds an x by y board.
+ *
+ * @param x Number of columns
+ * @param y Number of rows
+ * @return Level
+ */
+static int rootLevel(int x, int y){
+  int level;
+  level = LEAF_LEVEL + 1;
+  while((1L << level) < x || (1L << level) < y){
+    level++;
+  }
+  return level;
+}
+/**
+ * Make a run of cells alive in the loader's band.
+ * A row past the band first turns the band into leaves.
+ *
+ * @param state Engine state
+ * @param i First column of the run
+ * @param j Row
+ * @param n Length of the run
+ */
+static void hashLive(void *state, int i, int j, int n){
+  Hash *s;
+  uint64_t *row;
+  int bit, take;
+  s = (Hash *)state;
+  if(j >= s->bandRow + LEAF_SIZE){
+    flushBand(s);
+    s->bandRow = j - j % LEAF_SIZE;
+  }
+  row = s->band + (size_t)(j % LEAF_SIZE) * s->bandWords;
+  while(n > 0){
+    bit = i % 64;
+    take = 64 - bit < n ? 64 - bit : n;
+    row[i / 64] |= (take == 64 ? ~0ULL : (1ULL << take) - 1) << bit;
+    i += take;
+    n -= take;
+  }
+}
+/**
+ * Keep the non-empty leaves of the band and clear it.
+ *
+ * @param s Engine state
+ */
+static void flushBand(Hash *s){
+  uint64_t bits;
+  int k, b, r;
+  for(k = 0; k < s->bandWords; k++){
+    for(b = 0; b < 64 / LEAF_SIZE; b++){
+      bits = 0;
+      for(r = 0; r < LEAF_SIZE; r++){
+	bits |= ((s->band[(size_t)r * s->bandWords + k] >> (b * LEAF_SIZE)) &
+		 LEAF_ROW) << (r * LEAF_SIZE);
+      }
+      if(bits == 0){
+	continue;
+      }
+      if(s->pendingCount == s->pendingSize){
+	s->pendingSize = s->pendingSize ? s->pendingSize * 2 : 1024;
+	s->pending = (Pending *)realloc(s->pending,
+					s->pendingSize * sizeof(Pending));
+	if(s->pending == NULL){
+	  printf("Cannot Allocate Engine\n");
+	  exit(2);
+	}
+      }
+      s->pending[s->pendingCount].key =
+	interleave(k * (64 / LEAF_SIZE) + b, s->bandRow / LEAF_SIZE);
+      s->pending[s->pendingCount].bits = bits;
+      s->pendingCount++;
+    }
+  }
+  memset(s->band, 0, (size_t)s->bandWords * LEAF_SIZE * sizeof(uint64_t));
+}
+/**
+ * Build the tree from the loaded leaves, if it is not built yet.
+ * Sorted by interleaved position, the leaves of any square of the
+ * tree lie next to each other in the list.
+ *
+ * @param s Engine state
+ */
+static void settle(Hash *s){
+  if(s->root != NULL){
+    return;
+  }
+  flushBand(s);
+  qsort(s->pending, s->pendingCount, sizeof(Pending), comparePending);
+  s->root = buildPending(s, s->pending, s->pendingCount,
+			 rootLevel(s->x, s->y));
+  free(s->pending);
+  free(s->band);
+  s->pending = NULL;
+  s->band = NULL;
+}
+/**
+ * Order leaves by interleaved position.
+ *
+ * @param a Leaf
+ * @param b Leaf
+ * @return Less than, equal to or greater than 0 as a is before b
+ */
+static int comparePending(const void *a, const void *b){
+  uint64_t ka, kb;
+  ka = ((const Pending *)a)->key;
+  kb = ((const Pending *)b)->key;
+  return (ka > kb) - (ka < kb);
+}
+/**
+ * Interleave the bits of a leaf's column and row,
+ * column bits in the even places.
+ *
+ * @param column Leaf column
+ * @param row Leaf row
+ * @return Key
+ */
+static uint64_t interleave(uint32_t column, uint32_t row){
+  uint64_t key;
+  int b;
+  key = 0;
+  for(b = 0; b < 32; b++){
+    key |= (uint64_t)((column >> b) & 1) << (2 * b);
+    key |= (uint64_t)((row >> b) & 1) << (2 * b + 1);
+  }
+  return key;
+}
+/**
+ * Build the node for a run of sorted leaves.
+ * Two bits of the key at each level pick the quarter of a leaf.
+ *
+ * @param s Engine state
+ * @param list Leaves, all inside this node
+ * @param count Number of leaves
+ * @param level Level of the node
+ * @return The node
+ */
+static Node *buildPending(Hash *s, Pending *list, size_t count, int level){
+  Node *quarter[4];
+  size_t start, end;
+  int q, shift;
+  if(count == 0){
+    return emptyNode(s, level);
+  }
+  if(level == LEAF_LEVEL){
+    return findLeaf(s, list[0].bits);
+  }
+  shift = 2 * (level - LEAF_LEVEL - 1);
+  start = 0;
+  for(q = 0; q < 4; q++){
+    for(end = start; end < count && (int)((list[end].key >> shift) & 3) == q;
+	end++);
+    quarter[q] = buildPending(s, list + start, end - start, level - 1);
+    start = end;
+  }
+  return join(s, quarter[0], quarter[1], quarter[2], quarter[3]);
+}
+/**
+ * Build the node for a square of the grid.
+ * Cells off the grid are dead.
+ *
+ * @param s Engine state
+ * @param g Grid
+ * @param level Level of the node
+ * @param left First column of the square
+ * @param top First row of the square
+ * @return The node
+ */
+static Node *buildNode(Hash *s, Grid *g, int level, int64_t left, int64_t top){
+  uint64_t bits;
+  int64_t half;
+  int i, j;
+  if(left >= g->x || top >= g->y){
+    return emptyNode(s, level);
+  }
+  if(level == LEAF_LEVEL){
+    bits = 0;
+    for(j = 0; j < LEAF_SIZE && top + j < g->y; j++){
+      for(i = 0; i < LEAF_SIZE && left + i < g->x; i++){
+	if(CELL(g, left + i, top + j) == ALIVE){
+	  bits |= 1ULL << (j * LEAF_SIZE + i);
+	}
+      }
+    }
+    return findLeaf(s, bits);
+  }
+  half = (int64_t)1 << (level - 1);
+  return join(s, buildNode(s, g, level - 1, left, top),
+	      buildNode(s, g, level - 1, left + half, top),
+	      buildNode(s, g, level - 1, left, top + half),
+	      buildNode(s, g, level - 1, left + half, top + half));
+}
+/**
+ * Advance the engine's step of 2^speed generations.
+ *
+ * @param state Engine state
+ */
+static void hashStep(void *state){
+  Hash *s;
+  s = (Hash *)state;
+  settle(s);
+  advance(s, s->speed);
+}
+/**
+ * Advance any number of generations,
+ * one power of two for each bit of the count.
+ *
+ * @param state Engine state
+ * @param generations Number of generations
+ */
+static void hashJump(void *state, uint64_t generations){
+  Hash *s;
+  int j;
+  s = (Hash *)state;
+  settle(s);
+  for(j = 0; j < 64; j++){
+    if((generations >> j) & 1){
+      advance(s, j);
+    }
+  }
+}
+/**
+ * Advance the root 2^step generations.
+ * The root is grown until the pattern sits in its middle quarter, so
+ * nothing can travel out of the centre that successor returns.
+ *
+ * @param s Engine state
+ * @param step Power of two of the generations
+ */
+static void advance(Hash *s, int step){
+  int level;
+  if(s->count * sizeof(Node) > s->limit){
+    collect(s);
+  }
+  while(s->root->level < step + 3 || s->root->level < LEAF_LEVEL + 2 ||
+	centre(s, centre(s, s->root))->population != s->root->population){
+    expand(s);
+  }
+  level = s->root->level;
+  s->root = successor(s, s->root, step);
+  s->left += (int64_t)1 << (level - 2);
+  s->top += (int64_t)1 << (level - 2);
+}
+/**
+ * Double the size of the root, keeping it in the middle.
+ *
+ * @param s Engine state
+ */
+static void expand(Hash *s){
+  Node *root, *e;
+  int level;
+  root = s->root;
+  level = root->level;
+  if(level >= MAX_LEVEL){
+    printf("Pattern too large for HashLife\n");
+    exit(2);
+  }
+  e = emptyNode(s, level - 1);
+  s->root = join(s, join(s, e, e, e, root->nw),
+		 join(s, e, e, root->ne, e),
+		 join(s, e, root->sw, e, e),
+		 join(s, root->se, e, e, e));
+  s->left -= (int64_t)1 << (level - 1);
+  s->top -= (int64_t)1 << (level - 1);
+}
+/**
+ * The centre half of a node, 2^step generations on.
+ * At full speed (step = level - 2) the nine overlapping sub-squares
+ * are advanced and then the four squares made from those, each by a
+ * quarter of the node. Slower steps take the centres of the nine
+ * unchanged and only advance the four.
+ *
+ * @param s Engine state
+ * @param n Node of level 4 or more
+ * @param step Power of two of the generations, at most level - 2
+ * @return Node one level down
+ */
+static Node *successor(Hash *s, Node *n, int step){
+  Node *part[9], *next[4];
+  int i;
+  if(n->population == 0){
+    return emptyNode(s, n->level - 1);
+  }
+  if(step == n->level - 2 && n->result != NULL){
+    return n->result;
+  }
+  if(step < n->level - 2 && n->partial != NULL && n->step == step){
+    return n->partial;
+  }
+  if(n->level == LEAF_LEVEL + 1){
+    return remember(n, step, leafStep(s, n, step));
+  }
+  part[0] = n->nw;
+  part[1] = join(s, n->nw->ne, n->ne->nw, n->nw->se, n->ne->sw);
+  part[2] = n->ne;
+  part[3] = join(s, n->nw->sw, n->nw->se, n->sw->nw, n->sw->ne);
+  part[4] = join(s, n->nw->se, n->ne->sw, n->sw->ne, n->se->nw);
+  part[5] = join(s, n->ne->sw, n->ne->se, n->se->nw, n->se->ne);
+  part[6] = n->sw;
+  part[7] = join(s, n->sw->ne, n->se->nw, n->sw->se, n->se->sw);
+  part[8] = n->se;
+  for(i = 0; i < 9; i++){
+    part[i] = step == n->level - 2 ?
+      successor(s, part[i], step - 1) : centre(s, part[i]);
+  }
+  next[0] = join(s, part[0], part[1], part[3], part[4]);
+  next[1] = join(s, part[1], part[2], part[4], part[5]);
+  next[2] = join(s, part[3], part[4], part[6], part[7]);
+  next[3] = join(s, part[4], part[5], part[7], part[8]);
+  for(i = 0; i < 4; i++){
+    next[i] = successor(s, next[i], step == n->level - 2 ? step - 1 : step);
+  }
+  return remember(n, step, join(s, next[0], next[1], next[2], next[3]));
+}
+/**
+ * Keep the result of a step in the node.
+ * Full speed results never change, so they are kept apart from the
+ * result of a smaller step, which is replaced when the step changes.
+ *
+ * @param n Node
+ * @param step Power of two of the generations
+ * @param result Centre of the node advanced 2^step generations
+ * @return The result
+ */
+static Node *remember(Node *n, int step, Node *result){
+  if(step == n->level - 2){
+    n->result = result;
+  }
+  else{
+    n->partial = result;
+    n->step = step;
+  }
+  return result;
+}
+/**
+ * Advance the 16x16 square of four leaves up to 4 generations
+ * with the bit-sliced rule, one row of 16 cells per word.
+ * Cells at the edge go wrong a cell further in each generation,
+ * which never reaches the 8x8 centre that is kept.
+ *
+ * @param s Engine state
+ * @param n Node of level 4
+ * @param step Power of two of the generations, at most 2
+ * @return Leaf of the centre
+ */
+static Node *leafStep(Hash *s, Node *n, int step){
+  uint64_t rows[2 * LEAF_SIZE], next[2 * LEAF_SIZE], up, down, bits;
+  const RuleTerms *rule;
+  int r, g;
+  rule = s->terms.conway ? NULL : &s->terms;
+  for(r = 0; r < LEAF_SIZE; r++){
+    rows[r] = ((n->nw->bits >> (r * LEAF_SIZE)) & LEAF_ROW) |
+      ((n->ne->bits >> (r * LEAF_SIZE)) & LEAF_ROW) << LEAF_SIZE;
+    rows[r + LEAF_SIZE] = ((n->sw->bits >> (r * LEAF_SIZE)) & LEAF_ROW) |
+      ((n->se->bits >> (r * LEAF_SIZE)) & LEAF_ROW) << LEAF_SIZE;
+  }
+  for(g = 0; g < 1 << step; g++){
+    for(r = 0; r < 2 * LEAF_SIZE; r++){
+      up = r > 0 ? rows[r - 1] : 0;
+      down = r < 2 * LEAF_SIZE - 1 ? rows[r + 1] : 0;
+      next[r] = swarWord(rule, 0, up, 0, 0, rows[r], 0, 0, down, 0) &
+	0xFFFFULL;
+    }
+    memcpy(rows, next, sizeof(rows));
+  }
+  bits = 0;
+  for(r = 0; r < LEAF_SIZE; r++){
+    bits |= ((rows[r + LEAF_SIZE / 2] >> (LEAF_SIZE / 2)) & LEAF_ROW) <<
+      (r * LEAF_SIZE);
+  }
+  return findLeaf(s, bits);
+}
+/**
+ * The centre half of a node, not advanced.
+ *
+ * @param s Engine state
+ * @param n Node of level 4 or more
+ * @return Node one level down
+ */
+static Node *centre(Hash *s, Node *n){
+  uint64_t bits, row;
+  int r, half;
+  if(n->level > LEAF_LEVEL + 1){
+    return join(s, n->nw->se, n->ne->sw, n->sw->ne, n->se->nw);
+  }
+  half = LEAF_SIZE / 2;
+  bits = 0;
+  for(r = 0; r < half; r++){
+    row = ((n->nw->bits >> ((r + half) * LEAF_SIZE + half)) & 0xF) |
+      ((n->ne->bits >> ((r + half) * LEAF_SIZE)) & 0xF) << half;
+    bits |= row << (r * LEAF_SIZE);
+    row = ((n->sw->bits >> (r * LEAF_SIZE + half)) & 0xF) |
+      ((n->se->bits >> (r * LEAF_SIZE)) & 0xF) << half;
+    bits |= row << ((r + half) * LEAF_SIZE);
+  }
+  return findLeaf(s, bits);
+}
+/**
+ * The one leaf holding these cells.
+ *
+ * @param s Engine state
+ * @param bits Cells of the leaf
+ * @return The leaf
+ */
+static Node *findLeaf(Hash *s, uint64_t bits){
+  Node *n;
+  size_t b;
+  b = nodeHash(NULL, NULL, NULL, NULL, bits) & (s->buckets - 1);
+  for(n = s->table[b]; n != NULL; n = n->chain){
+    if(n->level == LEAF_LEVEL && n->bits == bits){
+      return n;
+    }
+  }
+  n = newNode(s);
+  n->bits = bits;
+  n->population = __builtin_popcountll(bits);
+  n->level = LEAF_LEVEL;
+  b = nodeHash(NULL, NULL, NULL, NULL, bits) & (s->buckets - 1);
+  n->chain = s->table[b];
+  s->table[b] = n;
+  return n;
+}
+/**
+ * The one node made of these four quarters.
+ *
+ * @param s Engine state
+ * @param nw North-west quarter, ne, sw and se the others
+ * @return The node, one level above the quarters
+ */
+static Node *join(Hash *s, Node *nw, Node *ne, Node *sw, Node *se){
+  Node *n;
+  size_t b;
+  b = nodeHash(nw, ne, sw, se, 0) & (s->buckets - 1);
+  for(n = s->table[b]; n != NULL; n = n->chain){
+    if(n->nw == nw && n->ne == ne && n->sw == sw && n->se == se){
+      return n;
+    }
+  }
+  n = newNode(s);
+  n->nw = nw;
+  n->ne = ne;
+  n->sw = sw;
+  n->se = se;
+  n->population = nw->population + ne->population +
+    sw->population + se->population;
+  n->level = nw->level + 1;
+  b = nodeHash(nw, ne, sw, se, 0) & (s->buckets - 1);
+  n->chain = s->table[b];
+  s->table[b] = n;
+  return n;
+}
+/**
+ * The empty node of a level.
+ *
+ * @param s Engine state
+ * @param level Level
+ * @return The node
+ */
+static Node *emptyNode(Hash *s, int level){
+  Node *e;
+  if(s->empty[level] == NULL){
+    if(level == LEAF_LEVEL){
+      s->empty[level] = findLeaf(s, 0);
+    }
+    else{
+      e = emptyNode(s, level - 1);
+      s->empty[level] = join(s, e, e, e, e);
+    }
+  }
+  return s->empty[level];
+}
+/**
+ * Take a cleared node from the free list, adding a block if needed.
+ * The caller links it into the table.
+ *
+ * @param s Engine state
+ * @return The node
+ */
+static Node *newNode(Hash *s){
+  Block *block;
+  Node *n;
+  int i;
+  if(s->count >= s->buckets){
+    growTable(s);
+  }
+  if(s->free == NULL){
+    block = (Block *)malloc(sizeof(Block));
+    if(block == NULL){
+      printf("Cannot Allocate Node\n");
+      exit(2);
+    }
+    block->next = s->blocks;
+    s->blocks = block;
+    for(i = 0; i < NODE_BLOCK; i++){
+      block->nodes[i].chain = s->free;
+      s->free = &block->nodes[i];
+    }
+  }
+  n = s->free;
+  s->free = n->chain;
+  memset(n, 0, sizeof(Node));
+  s->count++;
+  return n;
+}
+/**
+ * Hash a node from its quarters, or a leaf from its cells.
+ *
+ * @param nw North-west quarter, ne, sw and se the others
+ * @param bits Cells of a leaf
+ * @return Hash
+ */
+static size_t nodeHash(Node *nw, Node *ne, Node *sw, Node *se, uint64_t bits){
+  uint64_t h;
+  h = bits * 0x9E3779B97F4A7C15ULL;
+  h = (h ^ (uintptr_t)nw) * 0xBF58476D1CE4E5B9ULL;
+  h = (h ^ (uintptr_t)ne) * 0x94D049BB133111EBULL;
+  h = (h ^ (uintptr_t)sw) * 0xBF58476D1CE4E5B9ULL;
+  h = (h ^ (uintptr_t)se) * 0x94D049BB133111EBULL;
+  /* Multiplying only carries upwards, fold the top bits back down */
+  h = (h ^ (h >> 32)) * 0xBF58476D1CE4E5B9ULL;
+  return (size_t)(h ^ (h >> 29));
+}
+/**
+ * Double the number of buckets and rehash every node.
+ *
+ * @param s Engine state
+ */
+static void growTable(Hash *s){
+  Node **old, *n, *chain;
+  size_t b, size;
+  old = s->table;
+  size = s->buckets;
+  s->buckets *= 2;
+  s->table = (Node **)calloc(s->buckets, sizeof(Node *));
+  if(s->table == NULL){
+    printf("Cannot Allocate Engine\n");
+    exit(2);
+  }
+  for(b = 0; b < size; b++){
+    for(n = old[b]; n != NULL; n = chain){
+      chain = n->chain;
+      n->chain = s->table[nodeHash(n->nw, n->ne, n->sw, n->se, n->bits) &
+			  (s->buckets - 1)];
+      s->table[nodeHash(n->nw, n->ne, n->sw, n->se, n->bits) &
+	       (s->buckets - 1)] = n;
+    }
+  }
+  free(old);
+}
+/**
+ * Free every node that is not part of the current tree.
+ * Results that point at freed nodes are forgotten,
+ * the rest are kept for the next jump.
+ *
+ * @param s Engine state
+ */
+static void collect(Hash *s){
+  Node **link, *n;
+  size_t b;
+  int level;
+  markNode(s->root);
+  for(level = LEAF_LEVEL; level <= MAX_LEVEL; level++){
+    markNode(s->empty[level]);
+  }
+  for(b = 0; b < s->buckets; b++){
+    for(n = s->table[b]; n != NULL; n = n->chain){
+      if(n->mark && n->result != NULL && !n->result->mark){
+	n->result = NULL;
+      }
+      if(n->mark && n->partial != NULL && !n->partial->mark){
+	n->partial = NULL;
+      }
+    }
+  }
+  for(b = 0; b < s->buckets; b++){
+    link = &s->table[b];
+    while(*link != NULL){
+      n = *link;
+      if(n->mark){
+	n->mark = 0;
+	link = &n->chain;
+      }
+      else{
+	*link = n->chain;
+	n->chain = s->free;
+	s->free = n;
+	s->count--;
+      }
+    }
+  }
+}
+/**
+ * Mark a node and everything under it.
+ *
+ * @param n Node, may be NULL
+ */
+static void markNode(Node *n){
+  if(n == NULL || n->mark){
+    return;
+  }
+  n->mark = 1;
+  if(n->level > LEAF_LEVEL){
+    markNode(n->nw);
+    markNode(n->ne);
+    markNode(n->sw);
+    markNode(n->se);
+  }
+}
+/**
+ * Copy the window of the loaded board out of the tree.
+ *
+ * @param state Engine state
+ * @param g Grid
+ */
+static void hashStore(void *state, Grid *g){
+  Hash *s;
+  s = (Hash *)state;
+  settle(s);
+  memset(g->cells, DEAD, (size_t)g->x * g->y);
+  storeNode(s->root, s->left, s->top, g);
+}
+/**
+ * Copy the live cells of a node that fall on the grid.
+ *
+ * @param n Node
+ * @param left Board column of the node's left edge
+ * @param top Board row of the node's top edge
+ * @param g Grid
+ */
+static void storeNode(Node *n, int64_t left, int64_t top, Grid *g){
+  int64_t size, half;
+  int i, j;
+  size = (int64_t)1 << n->level;
+  if(n->population == 0 || left >= g->x || top >= g->y ||
+     left + size <= 0 || top + size <= 0){
+    return;
+  }
+  if(n->level == LEAF_LEVEL){
+    for(j = 0; j < LEAF_SIZE; j++){
+      for(i = 0; i < LEAF_SIZE; i++){
+	if((n->bits >> (j * LEAF_SIZE + i)) & 1 &&
+	   left + i >= 0 && left + i < g->x &&
+	   top + j >= 0 && top + j < g->y){
+	  CELL(g, left + i, top + j) = ALIVE;
+	}
+      }
+    }
+    return;
+  }
+  half = size / 2;
+  storeNode(n->nw, left, top, g);
+  storeNode(n->ne, left + half, top, g);
+  storeNode(n->sw, left, top + half, g);
+  storeNode(n->se, left + half, top + half, g);
+}
+/**
+ * Free the engine state and every node.
+ *
+ * @param state Engine state
+ */
+static void hashDestroy(void *state){
+  Hash *s;
+  Block *block, *next;
+  s = (Hash *)state;
+  for(block = s->blocks; block != NULL; block = next){
+    next = block->next;
+    free(block);
+  }
+  free(s->table);
+  free(s->band);
+  free(s->pending);
+  free(s);
+}
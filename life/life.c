@@ -10,216 +10,1405 @@
  */
 #include <stdio.h>
 #include <stdlib.h>
-#include "neillsdl2.h"
+#include <string.h>
+#include "life.h"
+#include "render.h"
 
-#define ALIVE '#'
-#define DEAD '-'
-#define UNFILLED 'i'
-#define MAX_SIZE 50
-#define WHITE 255
-#define BLACK 0
 #define GREY 192
-#define MILLISECONDDELAY 200
+#define FRAME_MILLISECONDS 16
+/* Generations a second in the window unless chosen with -s */
+#define DEFAULT_RATE 5.0
+#define MINIMUM_RATE 0.125
+#define TEST_SEED 12345
+#define TEST_BOARDS 100
+#define TEST_SIZE 300
+#define TEST_GENERATIONS 64
+#define TEST_JUMP 37
+#define TEST_THREADS 4
+#define TEST_CYCLE_SIZE 24
+#define TEST_CYCLE_GENERATIONS 3000
+#define TEST_SOUPS 64
+#define TEST_NAME_SIZE 24
+/* A board of several bands and strips of tiles for the tiled engine,
+   with the budget cut to a few tiles a strip and too little to stage
+   a whole band of rows at once */
+#define TEST_TILED_X 3100
+#define TEST_TILED_Y 1300
+#define TEST_TILED_MEGABYTES 1
+#define TEST_TILED_GENERATIONS 8
+/* Written and read back by the self-test, then removed */
+#define TEST_OUTPUT "life.test.txt"
+#define TEST_CHANGE_BOARDS 20
+#define BENCH_SEED 4321
+#define BENCH_SECONDS 0.25
+#define BENCH_GENERATIONS (1ULL << 24)
+#define FNV_OFFSET 0xCBF29CE484222325ULL
+#define FNV_PRIME 0x100000001B3ULL
 
-void initial(char iniBoard[MAX_SIZE][MAX_SIZE],
-	    int status[MAX_SIZE][MAX_SIZE]);
-void inputBoard(int x, int y,
-	       char board[y][x],
-	       char iniBoard[MAX_SIZE][MAX_SIZE]);
-void nextGen(int x, int y, 
-	    char setBoard[MAX_SIZE][MAX_SIZE],
-	    int status[MAX_SIZE][MAX_SIZE]);
-void getNeighbours(int x, int y, 
-		  char chkBoard[MAX_SIZE][MAX_SIZE], 
-		  int status[MAX_SIZE][MAX_SIZE]);
-void drawBoard(char iniBoard[MAX_SIZE][MAX_SIZE],
-	      SDL_Simplewin sw, SDL_Rect rectangle, 
-	     int x, int y);
+/* Choices from the command line */
+struct options{
+  char *file;
+  Engine *engine;
+  uint64_t generation;
+  int speed;
+  /* Memory for HashLife's nodes or the tiled engine's bands */
+  size_t megabytes;
+  /* Directory of the tiled engine's files, NULL for the current one */
+  char *tiles;
+  int threads;
+  char *rule;
+  /* What lies past the edge, NULL for a dead edge */
+  char *topology;
+  /* Generations a second in the window, SPEED_MAX or SPEED_STEP */
+  double rate;
+  /* Headless run of this many generations, printing the board or hash */
+  int headless;
+  uint64_t generations;
+  int hash;
+  /* Watch the headless run for cycles, 2 for ships as well */
+  int cycles;
+  /* Checkpoint written at the end of a headless run, and every
+     interval generations when that is not 0 */
+  char *checkpoint;
+  uint64_t interval;
+  int compress;
+  /* Statistics of every generation of a headless run, CSV or binary */
+  char *stats;
+  int binary;
+  /* Census of this many random soups, each a square of this side */
+  uint64_t census;
+  int soup;
+  uint64_t seed;
+  int test;
+  int bench;
+};
+typedef struct options Options;
+
+void readOptions(int argc, char *argv[], Options *opt);
+Engine *findEngine(char *name);
+void advanceTo(Engine *engine, void *state, uint64_t generations);
+int selfTest(void);
+int testEngine(Engine *engine, Engine *reference, uint64_t span, char *label);
+int testRule(char *rule);
+int testCycles(void);
+int testTopology(int topology);
+int testGlider(Engine *engine, int topology);
+int testStats(Engine *engine, char *label);
+int testCensus(void);
+int testNames(void);
+int testTiled(int threads);
+int testOutput(void);
+int testChanges(Engine *engine, char *label);
+void *feedEngine(Engine *engine, Grid *g);
+void *loadState(Engine *engine, char *name, int *x, int *y,
+		uint64_t *generation);
+int runHeadless(Engine *engine, Options *opt);
+void printGrid(FILE *out, Grid *g);
+void printRow(void *arg, char *cells, int x);
+uint64_t hashGrid(Grid *g);
+uint64_t hashCells(uint64_t h, char *cells, size_t n);
+void hashRow(void *arg, char *cells, int x);
+int benchmark(void);
+void benchEngines(Grid *g, char *pattern);
+double benchEngine(Engine *engine, Grid *g, char *pattern);
+void readEvents(SDL_Simplewin *sw, View *view, Simulation *sim,
+		double *resume);
+
+/* Engines selectable with -e, the first is the default */
+Engine *engines[] = {&scalarEngine, &swarEngine, &simdEngine, &blockEngine,
+		     &tiledEngine, &sparseEngine, &planeEngine, &hashEngine,
+		     NULL};
 
 int main(int argc, char *argv[]){
-  int x, y, i, j;
-  FILE *file;
-  char iniBoard[MAX_SIZE][MAX_SIZE];
-  int status[MAX_SIZE][MAX_SIZE];
   SDL_Simplewin sw;
-  SDL_Rect rectangle;
+  View *view;
+  Simulation *sim;
+  Options opt;
+  Engine *engine;
+  void *state;
+  double resume;
+  unsigned char *changed;
+  Grid *grid;
+  Uint32 start, spent;
+  uint64_t saved;
+  int x, y;
 
-  file = NULL;
+  readOptions(argc, argv, &opt);
+  engine = opt.engine;
+  ruleInit(opt.rule);
+  topologyInit(opt.topology);
+  lifeStats = opt.stats != NULL;
+  simdInit(NULL);
+  hashInit(opt.speed, opt.megabytes);
+  tiledInit(opt.tiles, opt.megabytes);
+  /* The census runs its soups on threads of its own */
+  poolInit(opt.census > 0 ? 1 : opt.threads);
+  if(opt.test){
+    return selfTest();
+  }
+  if(opt.census > 0){
+    takeCensus(engine, opt.census, opt.soup, opt.seed, opt.generations,
+	       opt.threads, 1);
+    return 0;
+  }
+  if(opt.bench){
+    return benchmark();
+  }
+  if(opt.headless){
+    return runHeadless(engine, &opt);
+  }
   Neill_SDL_Init(&sw);
-  initial(iniBoard, status);
-  file = fopen(argv[1], "r");
-  /* fopen returns NULL pointer on failure */
-  if (file == NULL){
-    printf("Could not open file. \n");
-  }
-  else {
-    printf("File (%s) opened. \n", argv[1]);
-    fscanf(file, "%d %d", &x, &y);
-    printf("Row: %d Column: %d \n", x, y);
-    char board[y][x];
-    if(fgetc(file) != EOF){
-      for(j = 0; j < y; j++){
-	for(i = 0; i < x + 1; i++){
-	  board[j][i] = fgetc(file);
-	}
-      }
-    }
-    /* Closing file */
-    fclose(file);
-    /* Input the board which read from the txt file to a 50x50 board*/
-    inputBoard(x, y, board, iniBoard);
+  /* The window redraws and stores only the squares the engine marks */
+  lifeChanges = 1;
+  /* The pattern goes straight into the engine, the grid is for drawing */
+  state = loadState(engine, opt.file, &x, &y, &saved);
+  if(state != NULL){
+    view = openView(&sw, x, y);
+    advanceTo(engine, state, opt.generation);
+    /* The engine steps on its own thread, the window shows its latest */
+    sim = startSimulation(engine, state, x, y, opt.rate);
+    resume = opt.rate == SPEED_STEP ? DEFAULT_RATE : opt.rate;
     do{
-      /* Sleep for a short time */
-      SDL_Delay(MILLISECONDDELAY);
-      SDL_RenderClear(sw.renderer);   
-      /* Draw the actual board */
-      drawBoard(iniBoard, sw, rectangle, x, y);      
-      /* Update window */
+      start = SDL_GetTicks();
+      Neill_SDL_SetDrawColour(&sw, GREY, GREY, GREY);
+      SDL_RenderClear(sw.renderer);
+      grid = latestGeneration(sim, &changed);
+      drawView(view, grid, changed);
       SDL_RenderPresent(sw.renderer);
-      SDL_UpdateWindowSurface(sw.win); 
-      /* Get the neighbours' status */
-      getNeighbours(x, y, iniBoard, status);
-      /* Calculate next generation */
-      nextGen(x, y, iniBoard, status);
-      Neill_SDL_Events(&sw);
+      SDL_UpdateWindowSurface(sw.win);
+      readEvents(&sw, view, sim, &resume);
+      /* Keep to the display rate, whatever the simulation's speed */
+      spent = SDL_GetTicks() - start;
+      if(spent < FRAME_MILLISECONDS){
+	SDL_Delay(FRAME_MILLISECONDS - spent);
+      }
     }while(!sw.finished);
+    stopSimulation(sim);
+    engine->destroy(state);
+    closeView(view);
     /* Clear up graphics subsystems */
     atexit(SDL_Quit);
   }
   return 0;
 }
 /**
- * Count the neighbours around the current point.
- * Store the number of neighours in a 2D array.
- * 
- * @param x Number of rows
- * @param y Number of columns
- * @param chkBoard Board
- * @param status Status of points
+ * Read the command line.
+ * Either a pattern file followed by any of -e <engine>,
+ * -g <generation>, -k <step power>, -m <megabytes>,
+ * -x <tile directory>, -t <threads>,
+ * -r <rule>, -b <dead|torus|klein>, -s <generations a second|max|step>,
+ * -n <generations> to run without a window, -o <board|hash>,
+ * -c <cycles|ships>, -w <checkpoint file>, -i <interval>,
+ * -z <raw|runs>, -p <statistics file> and -f <csv|binary>.
+ * Or -census <soups> followed by any of -e, -t, -r, -b, -n <most
+ * generations of a soup>, -a <soup size> and -j <seed>.
+ * Or -test or -bench on its own. Exit with the usage on anything else.
+ *
+ * @param argc Number of arguments
+ * @param argv Arguments
+ * @param opt Options to fill
+ */
+void readOptions(int argc, char *argv[], Options *opt){
+  int i, first;
+  opt->file = NULL;
+  opt->engine = engines[0];
+  opt->generation = 0;
+  opt->speed = 0;
+  opt->megabytes = 0;
+  opt->tiles = NULL;
+  opt->threads = 1;
+  opt->rule = NULL;
+  opt->topology = NULL;
+  opt->rate = DEFAULT_RATE;
+  opt->headless = 0;
+  opt->generations = 0;
+  opt->hash = 0;
+  opt->cycles = 0;
+  opt->checkpoint = NULL;
+  opt->interval = 0;
+  opt->compress = 0;
+  opt->stats = NULL;
+  opt->binary = 0;
+  opt->census = 0;
+  opt->soup = 0;
+  opt->seed = 1;
+  opt->test = 0;
+  opt->bench = 0;
+  if(argc == 2 && strcmp(argv[1], "-test") == 0){
+    opt->test = 1;
+    return;
+  }
+  if(argc == 2 && strcmp(argv[1], "-bench") == 0){
+    opt->bench = 1;
+    return;
+  }
+  first = 2;
+  if(argc >= 3 && strcmp(argv[1], "-census") == 0){
+    opt->census = strtoull(argv[2], NULL, 10);
+    first = 3;
+  }
+  if((argc - first) % 2 != 0 || (first == 2 && argv[1][0] == '-') ||
+     (first == 3 && opt->census == 0)){
+    printf("Usage : %s <pattern file> [-e <engine>] [-g <generation>] "
+	   "[-k <step power>] [-m <megabytes>] [-x <tile directory>] "
+	   "[-t <threads>] [-r <rule>] "
+	   "[-b <dead|torus|klein>] [-s <rate|max|step>] "
+	   "[-n <generations> [-o <board|hash>] [-c <cycles|ships>] "
+	   "[-w <checkpoint file> [-i <interval>] [-z <raw|runs>]] "
+	   "[-p <statistics file> [-f <csv|binary>]]] "
+	   "| -census <soups> [-e <engine>] [-t <threads>] [-r <rule>] "
+	   "[-b <dead|torus>] [-n <generations>] [-a <soup size>] "
+	   "[-j <seed>] | -test | -bench\n", argv[0]);
+    exit(1);
+  }
+  opt->file = opt->census > 0 ? NULL : argv[1];
+  for(i = first; i < argc; i += 2){
+    if(strcmp(argv[i], "-e") == 0){
+      opt->engine = findEngine(argv[i + 1]);
+      if(opt->engine == NULL){
+	printf("Unknown engine (%s). \n", argv[i + 1]);
+	exit(1);
+      }
+    }
+    else if(strcmp(argv[i], "-g") == 0){
+      opt->generation = strtoull(argv[i + 1], NULL, 10);
+    }
+    else if(strcmp(argv[i], "-k") == 0){
+      opt->speed = atoi(argv[i + 1]);
+    }
+    else if(strcmp(argv[i], "-m") == 0){
+      opt->megabytes = strtoul(argv[i + 1], NULL, 10);
+    }
+    else if(strcmp(argv[i], "-x") == 0){
+      opt->tiles = argv[i + 1];
+    }
+    else if(strcmp(argv[i], "-t") == 0){
+      opt->threads = atoi(argv[i + 1]);
+    }
+    else if(strcmp(argv[i], "-r") == 0){
+      opt->rule = argv[i + 1];
+    }
+    else if(strcmp(argv[i], "-b") == 0){
+      opt->topology = argv[i + 1];
+    }
+    else if(strcmp(argv[i], "-s") == 0){
+      if(strcmp(argv[i + 1], "max") == 0){
+	opt->rate = SPEED_MAX;
+      }
+      else if(strcmp(argv[i + 1], "step") == 0){
+	opt->rate = SPEED_STEP;
+      }
+      else{
+	opt->rate = atof(argv[i + 1]);
+	if(opt->rate < MINIMUM_RATE){
+	  printf("Unknown speed (%s). \n", argv[i + 1]);
+	  exit(1);
+	}
+      }
+    }
+    else if(strcmp(argv[i], "-n") == 0){
+      opt->headless = 1;
+      opt->generations = strtoull(argv[i + 1], NULL, 10);
+    }
+    else if(strcmp(argv[i], "-o") == 0 &&
+	    (strcmp(argv[i + 1], "board") == 0 ||
+	     strcmp(argv[i + 1], "hash") == 0)){
+      opt->hash = strcmp(argv[i + 1], "hash") == 0;
+    }
+    else if(strcmp(argv[i], "-c") == 0 &&
+	    (strcmp(argv[i + 1], "cycles") == 0 ||
+	     strcmp(argv[i + 1], "ships") == 0)){
+      opt->cycles = strcmp(argv[i + 1], "ships") == 0 ? 2 : 1;
+    }
+    else if(strcmp(argv[i], "-w") == 0){
+      opt->checkpoint = argv[i + 1];
+    }
+    else if(strcmp(argv[i], "-i") == 0){
+      opt->interval = strtoull(argv[i + 1], NULL, 10);
+    }
+    else if(strcmp(argv[i], "-z") == 0 &&
+	    (strcmp(argv[i + 1], "raw") == 0 ||
+	     strcmp(argv[i + 1], "runs") == 0)){
+      opt->compress = strcmp(argv[i + 1], "runs") == 0;
+    }
+    else if(strcmp(argv[i], "-p") == 0){
+      opt->stats = argv[i + 1];
+    }
+    else if(strcmp(argv[i], "-a") == 0 && atoi(argv[i + 1]) > 0){
+      opt->soup = atoi(argv[i + 1]);
+    }
+    else if(strcmp(argv[i], "-j") == 0){
+      opt->seed = strtoull(argv[i + 1], NULL, 10);
+    }
+    else if(strcmp(argv[i], "-f") == 0 &&
+	    (strcmp(argv[i + 1], "csv") == 0 ||
+	     strcmp(argv[i + 1], "binary") == 0)){
+      opt->binary = strcmp(argv[i + 1], "binary") == 0;
+    }
+    else{
+      printf("Unknown option (%s). \n", argv[i]);
+      exit(1);
+    }
+  }
+  if((opt->cycles || opt->census > 0) && !opt->engine->bounded){
+    printf("Engine (%s) has no edge to watch for cycles. \n",
+	   opt->engine->name);
+    exit(1);
+  }
+  if(opt->topology != NULL && strcmp(opt->topology, "dead") != 0 &&
+     !opt->engine->wraps){
+    printf("Engine (%s) cannot wrap its edges. \n", opt->engine->name);
+    exit(1);
+  }
+  if(opt->census > 0 && (opt->cycles || opt->checkpoint != NULL ||
+			 opt->stats != NULL ||
+			 (opt->topology != NULL &&
+			  strcmp(opt->topology, "klein") == 0))){
+    printf("A census runs on a dead or torus edge, without -c, -w or -p. \n");
+    exit(1);
+  }
+  if(opt->checkpoint != NULL && !opt->headless){
+    printf("Checkpoints are only written without a window (-n). \n");
+    exit(1);
+  }
+  if(opt->stats != NULL && (!opt->headless || opt->cycles)){
+    printf("Statistics need every generation of a run without a window "
+	   "(-n), without -c. \n");
+    exit(1);
+  }
+  if(opt->stats != NULL && opt->engine->stats == NULL){
+    printf("Engine (%s) cannot count statistics. \n", opt->engine->name);
+    exit(1);
+  }
+}
+/**
+ * Look up an engine by name.
+ *
+ * @param name Engine name
+ * @return The engine, NULL if there is none of that name
+ */
+Engine *findEngine(char *name){
+  int i;
+  for(i = 0; engines[i] != NULL; i++){
+    if(strcmp(engines[i]->name, name) == 0){
+      return engines[i];
+    }
+  }
+  return NULL;
+}
+/**
+ * Advance an engine a number of generations,
+ * with a single jump when the engine has one.
+ *
+ * @param engine Engine
+ * @param state Engine state
+ * @param generations Number of generations
+ */
+void advanceTo(Engine *engine, void *state, uint64_t generations){
+  uint64_t g;
+  if(engine->jump != NULL){
+    engine->jump(state, generations);
+    return;
+  }
+  for(g = 0; g < generations; g++){
+    engine->step(state);
+  }
+}
+/**
+ * Check every engine against the scalar engine.
+ * The simd engine is checked once for each kernel the CPU supports.
+ * The banded engines are checked again on TEST_THREADS threads.
+ * The unbounded engines are checked against each other, HashLife
+ * both a generation at a time and jumping TEST_JUMP at once.
+ * Then the same is done under a few other rules, and with the edges
+ * wrapped as a torus and a Klein bottle. Then the statistics the
+ * engines count are checked against the scalar engine's, a census
+ * is taken with several engines and numbers of threads, the tiled
+ * engine is run on a board of many tiles, and last a board printed
+ * as a headless run prints it is read back.
+ *
+ * @return 0 when all engines agree, 1 otherwise
+ */
+int selfTest(void){
+  char *isas[] = {"avx2", "sse2", "scalar", NULL};
+  char *rules[] = {"B36/S23", "B2/S", "B3678/S34678", NULL};
+  char label[64];
+  int i, t, failed;
+  failed = 0;
+  for(i = 0; engines[i] != NULL; i++){
+    if(engines[i] != &scalarEngine && engines[i] != &simdEngine &&
+       engines[i] != &planeEngine && engines[i] != &hashEngine){
+      failed |= testEngine(engines[i], &scalarEngine, 1, engines[i]->name);
+    }
+  }
+  for(i = 0; isas[i] != NULL; i++){
+    sprintf(label, "simd (%s)", isas[i]);
+    if(simdInit(isas[i]) == NULL){
+      printf("%-16s not supported\n", label);
+    }
+    else{
+      failed |= testEngine(&simdEngine, &scalarEngine, 1, label);
+    }
+  }
+  simdInit(NULL);
+  poolInit(TEST_THREADS);
+  sprintf(label, "swar (%d threads)", TEST_THREADS);
+  failed |= testEngine(&swarEngine, &scalarEngine, 1, label);
+  sprintf(label, "simd (%d threads)", TEST_THREADS);
+  failed |= testEngine(&simdEngine, &scalarEngine, 1, label);
+  sprintf(label, "block (%d threads)", TEST_THREADS);
+  failed |= testEngine(&blockEngine, &scalarEngine, 1, label);
+  poolInit(1);
+  /* The plane has no edge, so it cannot match a bounded board */
+  failed |= testEngine(&hashEngine, &planeEngine, 1, "hashlife");
+  sprintf(label, "hashlife (%d)", TEST_JUMP);
+  failed |= testEngine(&hashEngine, &planeEngine, TEST_JUMP, label);
+  for(i = 0; rules[i] != NULL; i++){
+    failed |= testRule(rules[i]);
+  }
+  failed |= testCycles();
+  failed |= testTopology(TOPOLOGY_TORUS);
+  failed |= testTopology(TOPOLOGY_KLEIN);
+  for(t = TOPOLOGY_DEAD; t <= TOPOLOGY_TORUS; t++){
+    lifeTopology = t;
+    sprintf(label, "swar stats %s", topologyName(t));
+    failed |= testStats(&swarEngine, label);
+    for(i = 0; isas[i] != NULL; i++){
+      if(simdInit(isas[i]) != NULL){
+	sprintf(label, "simd (%s) stats %s", isas[i], topologyName(t));
+	failed |= testStats(&simdEngine, label);
+      }
+    }
+    simdInit(NULL);
+  }
+  lifeTopology = TOPOLOGY_DEAD;
+  for(t = TOPOLOGY_DEAD; t <= TOPOLOGY_TORUS; t++){
+    lifeTopology = t;
+    for(i = 0; engines[i] != NULL; i++){
+      if(engines[i]->changes != NULL && engines[i]->storeArea != NULL &&
+	 (t == TOPOLOGY_DEAD || engines[i]->wraps)){
+	sprintf(label, "%s changes %s", engines[i]->name, topologyName(t));
+	failed |= testChanges(engines[i], label);
+      }
+    }
+  }
+  poolInit(TEST_THREADS);
+  sprintf(label, "swar (%d) changes", TEST_THREADS);
+  failed |= testChanges(&swarEngine, label);
+  sprintf(label, "simd (%d) changes", TEST_THREADS);
+  failed |= testChanges(&simdEngine, label);
+  poolInit(1);
+  lifeTopology = TOPOLOGY_DEAD;
+  failed |= testCensus();
+  failed |= testNames();
+  failed |= testTiled(1);
+  failed |= testTiled(TEST_THREADS);
+  failed |= testOutput();
+  return failed;
+}
+/**
+ * Check the engines against the scalar engine under another rule,
+ * and HashLife against the plane. Conway's rule is put back after.
+ *
+ * @param rule Rule
+ * @return 0 when all engines agree, 1 otherwise
+ */
+int testRule(char *rule){
+  char *isas[] = {"avx2", "sse2", "scalar", NULL};
+  char label[64];
+  Rule conway;
+  int i, failed;
+  conway = lifeRule;
+  parseRule(rule, &lifeRule);
+  failed = 0;
+  sprintf(label, "swar %s", rule);
+  failed |= testEngine(&swarEngine, &scalarEngine, 1, label);
+  sprintf(label, "sparse %s", rule);
+  failed |= testEngine(&sparseEngine, &scalarEngine, 1, label);
+  sprintf(label, "block %s", rule);
+  failed |= testEngine(&blockEngine, &scalarEngine, 1, label);
+  sprintf(label, "tiled %s", rule);
+  failed |= testEngine(&tiledEngine, &scalarEngine, 1, label);
+  for(i = 0; isas[i] != NULL; i++){
+    if(simdInit(isas[i]) != NULL){
+      sprintf(label, "simd (%s) %s", isas[i], rule);
+      failed |= testEngine(&simdEngine, &scalarEngine, 1, label);
+    }
+  }
+  simdInit(NULL);
+  sprintf(label, "hashlife %s", rule);
+  failed |= testEngine(&hashEngine, &planeEngine, 1, label);
+  lifeRule = conway;
+  return failed;
+}
+/**
+ * Check the engines that wrap against the scalar engine with the
+ * edges wrapped, and each of them with a glider crossing the edges.
+ * The edges are made dead again after.
+ *
+ * @param topology Topology
+ * @return 0 when all engines agree, 1 otherwise
+ */
+int testTopology(int topology){
+  char *isas[] = {"avx2", "sse2", "scalar", NULL};
+  char label[64];
+  int i, failed;
+  lifeTopology = topology;
+  failed = 0;
+  sprintf(label, "swar %s", topologyName(topology));
+  failed |= testEngine(&swarEngine, &scalarEngine, 1, label);
+  for(i = 0; isas[i] != NULL; i++){
+    if(simdInit(isas[i]) != NULL){
+      sprintf(label, "simd (%s) %s", isas[i], topologyName(topology));
+      failed |= testEngine(&simdEngine, &scalarEngine, 1, label);
+    }
+  }
+  simdInit(NULL);
+  poolInit(TEST_THREADS);
+  sprintf(label, "swar (%d) %s", TEST_THREADS, topologyName(topology));
+  failed |= testEngine(&swarEngine, &scalarEngine, 1, label);
+  sprintf(label, "simd (%d) %s", TEST_THREADS, topologyName(topology));
+  failed |= testEngine(&simdEngine, &scalarEngine, 1, label);
+  poolInit(1);
+  for(i = 0; engines[i] != NULL; i++){
+    if(engines[i]->wraps){
+      failed |= testGlider(engines[i], topology);
+    }
+  }
+  lifeTopology = TOPOLOGY_DEAD;
+  return failed;
+}
+/**
+ * Send a glider across the edges of a square board. It moves one
+ * cell across and down every four generations, so after crossing the
+ * board once it is back where it started on a torus, but mirrored on
+ * a Klein bottle until it has crossed twice.
+ *
+ * @param engine Engine
+ * @param topology Topology, a torus or a Klein bottle
+ * @return 0 when the glider comes back as expected, 1 otherwise
+ */
+int testGlider(Engine *engine, int topology){
+  char *glider[] = {"-#-", "--#", "###"};
+  char label[64];
+  Grid *start, *board;
+  void *state;
+  int i, j, crossed, same, failed;
+  start = allocateGrid(TEST_CYCLE_SIZE, TEST_CYCLE_SIZE);
+  board = allocateGrid(TEST_CYCLE_SIZE, TEST_CYCLE_SIZE);
+  for(j = 0; j < 3; j++){
+    for(i = 0; i < 3; i++){
+      CELL(start, i + 1, j + 1) = glider[j][i];
+    }
+  }
+  state = engine->create(start);
+  failed = 0;
+  for(crossed = 1; crossed <= 2; crossed++){
+    advanceTo(engine, state, 4 * TEST_CYCLE_SIZE);
+    engine->store(state, board);
+    same = memcmp(board->cells, start->cells,
+		  TEST_CYCLE_SIZE * TEST_CYCLE_SIZE) == 0;
+    failed |= same != (topology == TOPOLOGY_TORUS || crossed == 2);
+  }
+  engine->destroy(state);
+  freeGrid(start);
+  freeGrid(board);
+  sprintf(label, "%s %s glider", engine->name, topologyName(topology));
+  printf("%-16s %s\n", label, failed ? "FAILED" : "OK");
+  return failed;
+}
+/**
+ * Run random boards through an engine and the scalar engine, both
+ * counting statistics, and compare the counts after every generation.
+ *
+ * @param engine Engine to check
+ * @param label Name to report
+ * @return 0 when the counts agree, 1 otherwise
+ */
+int testStats(Engine *engine, char *label){
+  Grid *board;
+  Stats got, expected;
+  void *state, *check;
+  int n, x, y, i, g, density;
+  lifeStats = 1;
+  srand(TEST_SEED);
+  for(n = 0; n < TEST_BOARDS; n++){
+    x = 1 + rand() % TEST_SIZE;
+    y = 1 + rand() % TEST_SIZE;
+    density = rand() % 100;
+    board = allocateGrid(x, y);
+    for(i = 0; i < x * y; i++){
+      board->cells[i] = rand() % 100 < density ? ALIVE : DEAD;
+    }
+    state = engine->create(board);
+    check = scalarEngine.create(board);
+    for(g = 1; g <= TEST_GENERATIONS; g++){
+      engine->step(state);
+      scalarEngine.step(check);
+      engine->stats(state, &got);
+      scalarEngine.stats(check, &expected);
+      if(memcmp(&got, &expected, sizeof(Stats)) != 0){
+	printf("%-16s FAILED on a %dx%d board at generation %d\n",
+	       label, x, y, g);
+	break;
+      }
+    }
+    engine->destroy(state);
+    scalarEngine.destroy(check);
+    freeGrid(board);
+    if(g <= TEST_GENERATIONS){
+      break;
+    }
+  }
+  lifeStats = 0;
+  if(n < TEST_BOARDS){
+    return 1;
+  }
+  printf("%-16s %d boards OK\n", label, TEST_BOARDS);
+  return 0;
+}
+/**
+ * Run random boards through an engine marking its changes, and keep
+ * a grid up to date by storing only the squares it reports after a
+ * few generations at a time. The grid must match the whole board.
+ *
+ * @param engine Engine to check
+ * @param label Name to report
+ * @return 0 when the grid keeps up, 1 otherwise
+ */
+int testChanges(Engine *engine, char *label){
+  Grid *board, *shown, *expected;
+  unsigned char *tiles;
+  void *state;
+  int n, x, y, i, j, g, k, density, tilesX, tilesY;
+  lifeChanges = 1;
+  srand(TEST_SEED);
+  for(n = 0; n < TEST_CHANGE_BOARDS; n++){
+    x = 1 + rand() % TEST_SIZE;
+    y = 1 + rand() % TEST_SIZE;
+    density = rand() % 100;
+    tilesX = (x + CHANGE_TILE - 1) / CHANGE_TILE;
+    tilesY = (y + CHANGE_TILE - 1) / CHANGE_TILE;
+    board = allocateGrid(x, y);
+    shown = allocateGrid(x, y);
+    expected = allocateGrid(x, y);
+    tiles = (unsigned char *)malloc((size_t)tilesX * tilesY);
+    if(tiles == NULL){
+      printf("Cannot Allocate Test\n");
+      exit(2);
+    }
+    for(i = 0; i < x * y; i++){
+      board->cells[i] = rand() % 100 < density ? ALIVE : DEAD;
+    }
+    state = engine->create(board);
+    engine->store(state, shown);
+    for(g = 1; g <= TEST_GENERATIONS; g++){
+      for(k = rand() % 3; k >= 0; k--){
+	engine->step(state);
+      }
+      memset(tiles, 0, (size_t)tilesX * tilesY);
+      engine->changes(state, tiles);
+      for(j = 0; j < tilesY; j++){
+	for(i = 0; i < tilesX; i++){
+	  if(tiles[j * tilesX + i]){
+	    engine->storeArea(state, shown, i * CHANGE_TILE, j * CHANGE_TILE,
+			      (i + 1) * CHANGE_TILE < x ? (i + 1) * CHANGE_TILE : x,
+			      (j + 1) * CHANGE_TILE < y ? (j + 1) * CHANGE_TILE : y);
+	  }
+	}
+      }
+      engine->store(state, expected);
+      if(memcmp(shown->cells, expected->cells, (size_t)x * y) != 0){
+	printf("%-16s FAILED on a %dx%d board at generation %d\n",
+	       label, x, y, g);
+	break;
+      }
+    }
+    engine->destroy(state);
+    freeGrid(board);
+    freeGrid(shown);
+    freeGrid(expected);
+    free(tiles);
+    if(g <= TEST_GENERATIONS){
+      break;
+    }
+  }
+  lifeChanges = 0;
+  if(n < TEST_CHANGE_BOARDS){
+    return 1;
+  }
+  printf("%-16s %d boards OK\n", label, TEST_CHANGE_BOARDS);
+  return 0;
+}
+/**
+ * Take the same census with the scalar, swar and simd engines on one
+ * and on TEST_THREADS threads, on a dead edge and on a torus. The soups
+ * depend on the seed alone, so every tally should be the same.
+ *
+ * @return 0 when the tallies agree, 1 otherwise
  */
-void getNeighbours(int x, int y, 
-		  char chkBoard[MAX_SIZE][MAX_SIZE], 
-		  int status[MAX_SIZE][MAX_SIZE]){
-  int count, i, j;
-  for(j = 0; j < y; j++){
-    for(i = 0; i < x; i++){
-      count = 0;
-      if(chkBoard[j-1][i-1] == ALIVE){count++;}
-      if(chkBoard[j-1][i] == ALIVE){count++;}
-      if(chkBoard[j-1][i+1] == ALIVE){count++;}
-      if(chkBoard[j][i-1] == ALIVE){count++;}
-      if(chkBoard[j][i+1] == ALIVE){count++;}
-      if(chkBoard[j+1][i-1] == ALIVE){count++;}
-      if(chkBoard[j+1][i] == ALIVE){count++;}
-      if(chkBoard[j+1][i+1] == ALIVE){count++;}
-      status[j][i] = count;
+int testCensus(void){
+  Engine *checked[] = {&swarEngine, &simdEngine, &swarEngine, NULL};
+  int threads[] = {TEST_THREADS, 1, 1};
+  char label[64];
+  uint64_t expected;
+  int t, i;
+  for(t = TOPOLOGY_DEAD; t <= TOPOLOGY_TORUS; t++){
+    lifeTopology = t;
+    expected = takeCensus(&scalarEngine, TEST_SOUPS, 0, TEST_SEED, 0, 1, 0);
+    for(i = 0; checked[i] != NULL; i++){
+      if(takeCensus(checked[i], TEST_SOUPS, 0, TEST_SEED, 0, threads[i], 0) !=
+	 expected){
+	printf("%-16s FAILED with %s on %d threads\n", "census",
+	       checked[i]->name, threads[i]);
+	lifeTopology = TOPOLOGY_DEAD;
+	return 1;
+      }
     }
+    sprintf(label, "census %s", topologyName(t));
+    printf("%-16s %d soups OK\n", label, TEST_SOUPS);
   }
+  lifeTopology = TOPOLOGY_DEAD;
+  return 0;
 }
 /**
- * Calculate the next generation by 
- * checking the status of all the points.
- * 
- * @param x Number of rows
- * @param y Number of columns
- * @param setBoard Board
- * @param status Status of points
+ * Name a few objects alone on a board in every phase, as a census
+ * would, including the oscillators whose halves come apart, and two
+ * blocks that lie close but are two objects.
+ *
+ * @return 0 when every name is right, 1 otherwise
  */
-void nextGen(int x, int y, 
-	    char setBoard[MAX_SIZE][MAX_SIZE],
-	    int status[MAX_SIZE][MAX_SIZE]){
-  int i, j;
-  for(j = 0; j < y; j++){
-    for(i = 0; i < x; i++){
-      if(setBoard[j][i] == ALIVE && 
-	 status[j][i] == (2 || 3)){
-	setBoard[j][i] = ALIVE;
+int testNames(void){
+  char *shapes[] = {"##/##", "###", "-###/###-", "##/#/---#/--##",
+		    "-#/--#/###", "##-##/##-##", NULL};
+  int periods[] = {1, 2, 2, 2, 4, 1};
+  char *expected[] = {"xs4_##/##", "xp2_###", "xp2_###-/-###",
+		      "xp2_##--/##--/--##/--##", "xq4_###/#--/-#-",
+		      "xs4_##/## xs4_##/##"};
+  Grid *board;
+  void *state;
+  char *names, *c;
+  int k, i, j, phase, failed;
+  failed = 0;
+  board = allocateGrid(TEST_NAME_SIZE, TEST_NAME_SIZE);
+  for(k = 0; shapes[k] != NULL && !failed; k++){
+    memset(board->cells, DEAD, TEST_NAME_SIZE * TEST_NAME_SIZE);
+    i = j = TEST_NAME_SIZE / 3;
+    for(c = shapes[k]; *c != '\0'; c++){
+      if(*c == '/'){
+	i = TEST_NAME_SIZE / 3;
+	j++;
       }
-      if(setBoard[j][i] == ALIVE &&
-	 (status[j][i] < 2 || status[j][i] > 3)){
-	setBoard[j][i] = DEAD;
+      else{
+	CELL(board, i++, j) = *c;
       }
-      if(setBoard[j][i] == DEAD &&
-	 status[j][i] == 3){
-	setBoard[j][i] = ALIVE;
+    }
+    state = scalarEngine.create(board);
+    for(phase = 0; phase < periods[k] && !failed; phase++){
+      scalarEngine.store(state, board);
+      names = censusNames(board);
+      if(strcmp(names, expected[k]) != 0){
+	printf("%-16s FAILED, %s in phase %d named %s\n", "census names",
+	       shapes[k], phase, names);
+	failed = 1;
       }
+      free(names);
+      scalarEngine.step(state);
+    }
+    scalarEngine.destroy(state);
+  }
+  freeGrid(board);
+  if(!failed){
+    printf("%-16s %d objects OK\n", "census names", k);
+  }
+  return failed;
+}
+/**
+ * Check the tiled engine against the swar engine on a board of
+ * several bands of tiles, in strips narrower than the board, a
+ * generation at a time and then in one jump. The board goes in and
+ * out a few rows at a time.
+ *
+ * @param threads Number of threads in the pool
+ * @return 0 when the engines agree, 1 otherwise
+ */
+int testTiled(int threads){
+  Grid *board, *expected;
+  void *state, *check;
+  char label[64];
+  int i, g, same;
+  poolInit(threads);
+  tiledInit(NULL, TEST_TILED_MEGABYTES);
+  srand(TEST_SEED);
+  board = allocateGrid(TEST_TILED_X, TEST_TILED_Y);
+  expected = allocateGrid(TEST_TILED_X, TEST_TILED_Y);
+  for(i = 0; i < TEST_TILED_X * TEST_TILED_Y; i++){
+    board->cells[i] = rand() % 3 ? DEAD : ALIVE;
+  }
+  state = feedEngine(&tiledEngine, board);
+  check = swarEngine.create(board);
+  same = 1;
+  for(g = 0; g <= TEST_TILED_GENERATIONS && same; g++){
+    /* The last round jumps as far as all the others */
+    advanceTo(&tiledEngine, state, g < TEST_TILED_GENERATIONS ? 1 :
+	      TEST_TILED_GENERATIONS);
+    advanceTo(&swarEngine, check, g < TEST_TILED_GENERATIONS ? 1 :
+	      TEST_TILED_GENERATIONS);
+    tiledEngine.store(state, board);
+    swarEngine.store(check, expected);
+    same = memcmp(board->cells, expected->cells,
+		  (size_t)TEST_TILED_X * TEST_TILED_Y) == 0;
+  }
+  tiledEngine.destroy(state);
+  swarEngine.destroy(check);
+  freeGrid(board);
+  freeGrid(expected);
+  tiledInit(NULL, 0);
+  poolInit(1);
+  sprintf(label, "tiled (%d)", threads);
+  if(!same){
+    printf("%-16s FAILED at generation %d\n", label, g);
+    return 1;
+  }
+  printf("%-16s %dx%d board OK\n", label, TEST_TILED_X, TEST_TILED_Y);
+  return 0;
+}
+/**
+ * Print a random board the way a headless run does into a file, and
+ * read it back as a pattern. The run's status lines go to stderr, so
+ * its output can be fed straight back in.
+ *
+ * @return 0 when the board reads back the same, 1 otherwise
+ */
+int testOutput(void){
+  Grid *board, *loaded;
+  FILE *out;
+  int i, same;
+  srand(TEST_SEED);
+  board = allocateGrid(TEST_SIZE, TEST_CYCLE_SIZE);
+  for(i = 0; i < TEST_SIZE * TEST_CYCLE_SIZE; i++){
+    board->cells[i] = rand() % 3 ? DEAD : ALIVE;
+  }
+  out = fopen(TEST_OUTPUT, "w");
+  if(out == NULL){
+    printf("%-16s FAILED, could not write %s\n", "output", TEST_OUTPUT);
+    freeGrid(board);
+    return 1;
+  }
+  printGrid(out, board);
+  fclose(out);
+  loaded = loadGrid(TEST_OUTPUT);
+  remove(TEST_OUTPUT);
+  same = loaded != NULL && loaded->x == board->x && loaded->y == board->y &&
+    memcmp(loaded->cells, board->cells, (size_t)board->x * board->y) == 0;
+  freeGrid(board);
+  if(loaded != NULL){
+    freeGrid(loaded);
+  }
+  if(!same){
+    printf("%-16s FAILED to read back\n", "output");
+    return 1;
+  }
+  printf("%-16s %dx%d board OK\n", "output", TEST_SIZE, TEST_CYCLE_SIZE);
+  return 0;
+}
+/**
+ * Run small random boards a long way with cycle detection and
+ * compare them with the same boards simply stepped.
+ *
+ * @return 0 when the boards agree, 1 otherwise
+ */
+int testCycles(void){
+  Grid *board, *expected;
+  void *state, *check;
+  Cycle cycle;
+  uint64_t simulated, saved;
+  int n, i, found;
+  srand(TEST_SEED);
+  found = 0;
+  saved = 0;
+  for(n = 0; n < TEST_BOARDS; n++){
+    board = allocateGrid(TEST_CYCLE_SIZE, TEST_CYCLE_SIZE);
+    expected = allocateGrid(TEST_CYCLE_SIZE, TEST_CYCLE_SIZE);
+    for(i = 0; i < TEST_CYCLE_SIZE * TEST_CYCLE_SIZE; i++){
+      board->cells[i] = rand() % 3 ? DEAD : ALIVE;
     }
+    state = swarEngine.create(board);
+    check = swarEngine.create(board);
+    simulated = runCycles(&swarEngine, state, TEST_CYCLE_SIZE,
+			  TEST_CYCLE_SIZE, TEST_CYCLE_GENERATIONS,
+			  n % 2, &cycle);
+    swarEngine.jump(check, TEST_CYCLE_GENERATIONS);
+    swarEngine.store(state, board);
+    swarEngine.store(check, expected);
+    swarEngine.destroy(state);
+    swarEngine.destroy(check);
+    i = memcmp(board->cells, expected->cells,
+	       TEST_CYCLE_SIZE * TEST_CYCLE_SIZE);
+    freeGrid(board);
+    freeGrid(expected);
+    if(i != 0){
+      printf("%-16s FAILED on board %d, period %d from generation %d\n",
+	     "cycles", n, (int)cycle.period, (int)cycle.onset);
+      return 1;
+    }
+    found += cycle.period > 0;
+    saved += TEST_CYCLE_GENERATIONS - simulated;
   }
+  printf("%-16s %d boards OK, %d cycles skipping %.0f%% of generations\n",
+	 "cycles", TEST_BOARDS, found,
+	 100.0 * saved / ((double)TEST_BOARDS * TEST_CYCLE_GENERATIONS));
+  return 0;
 }
 /**
- * Input the board which read from the txt file to a 50x50 board
- * 
- * @param x Number of rows
- * @param y Number of columns
- * @param board Board read from the txt file
- * @param iniBoard Board
+ * Run random boards through an engine and a reference engine
+ * side by side and compare them after every span of generations.
+ * The same seed is used for every engine. Every other board is fed
+ * to the engine in runs, the way the pattern loader does.
+ *
+ * @param engine Engine to check
+ * @param reference Engine to compare against, stepped one at a time
+ * @param span Generations between comparisons
+ * @param label Name to report
+ * @return 0 when the engines agree, 1 otherwise
  */
-void inputBoard(int x, int y,
-	       char board[y][x],
-	       char iniBoard[MAX_SIZE][MAX_SIZE]){
-  int i, j;
-  for(j = 0; j < y; j++){
-    for(i = 0; i < x; i++){
-      iniBoard[j][i] = board[j][i];
+int testEngine(Engine *engine, Engine *reference, uint64_t span, char *label){
+  Grid *board, *expected;
+  void *state, *check;
+  int n, x, y, i, j, g, density;
+  srand(TEST_SEED);
+  for(n = 0; n < TEST_BOARDS; n++){
+    x = 1 + rand() % TEST_SIZE;
+    y = 1 + rand() % TEST_SIZE;
+    density = rand() % 100;
+    board = allocateGrid(x, y);
+    expected = allocateGrid(x, y);
+    for(j = 0; j < y; j++){
+      for(i = 0; i < x; i++){
+	CELL(board, i, j) = rand() % 100 < density ? ALIVE : DEAD;
+      }
+    }
+    state = n % 2 ? feedEngine(engine, board) : engine->create(board);
+    check = reference->create(board);
+    for(g = 1; g <= TEST_GENERATIONS; g++){
+      if(span == 1){
+	engine->step(state);
+      }
+      else{
+	advanceTo(engine, state, span);
+      }
+      advanceTo(reference, check, span);
+      engine->store(state, board);
+      reference->store(check, expected);
+      if(memcmp(board->cells, expected->cells, (size_t)x * y) != 0){
+	printf("%-16s FAILED on a %dx%d board at generation %d\n",
+	       label, x, y, (int)(g * span));
+	break;
+      }
+    }
+    engine->destroy(state);
+    reference->destroy(check);
+    freeGrid(board);
+    freeGrid(expected);
+    if(g <= TEST_GENERATIONS){
+      return 1;
     }
   }
+  printf("%-16s %d boards OK\n", label, TEST_BOARDS);
+  return 0;
 }
 /**
- * Initialise the board with char 'i'
- * Initialise the status with number 0
+ * Create an engine from a grid's runs of live cells, row by row.
  *
- * @param iniBoard Board
- * @param status Status of points
+ * @param engine Engine
+ * @param g Grid
+ * @return The new engine state
  */
-void initial(char iniBoard[MAX_SIZE][MAX_SIZE],
-	    int status[MAX_SIZE][MAX_SIZE]){
-  int i, j;
-  for(j = 0; j < MAX_SIZE; j++){
-    for(i = 0; i < MAX_SIZE; i++){
-      iniBoard[j][i] = 'i';
-      status[j][i] = 0;
+void *feedEngine(Engine *engine, Grid *g){
+  void *state;
+  int i, j, start;
+  state = engine->blank(g->x, g->y);
+  for(j = 0; j < g->y; j++){
+    for(i = 0; i < g->x; i = start){
+      for(; i < g->x && CELL(g, i, j) != ALIVE; i++);
+      for(start = i; start < g->x && CELL(g, start, j) == ALIVE; start++);
+      if(start > i){
+	engine->live(state, i, j, start - i);
+      }
     }
   }
+  return state;
+}
+/**
+ * Load a pattern file or a checkpoint into a new engine state.
+ *
+ * @param engine Engine
+ * @param name File name
+ * @param x Set to the number of columns
+ * @param y Set to the number of rows
+ * @param generation Set to the checkpoint's generation, 0 for a pattern
+ * @return The state, NULL if the file cannot be read
+ */
+void *loadState(Engine *engine, char *name, int *x, int *y,
+		uint64_t *generation){
+  void *state;
+  *generation = 0;
+  if(!isCheckpoint(name)){
+    return loadPattern(name, engine->blank, engine->live, x, y);
+  }
+  state = loadCheckpoint(name, engine->blank, engine->live, x, y,
+			 generation);
+  /* The checkpoint's topology is only known once it is read */
+  if(state != NULL && lifeTopology != TOPOLOGY_DEAD && !engine->wraps){
+    printf("Engine (%s) cannot wrap the edges of a %s checkpoint. \n",
+	   engine->name, topologyName(lifeTopology));
+    engine->destroy(state);
+    return NULL;
+  }
+  return state;
 }
 /**
- * Draw the actual board.
- * Draw the alive cell in black
- * Draw the dead cell in white
- * Draw the unfilled area in grey
+ * Run a pattern without a window as fast as the engine goes,
+ * then print the final board or its hash. Watching for cycles, the
+ * cycle is reported and the generations after it are skipped.
+ * A run from a checkpoint carries on from the checkpoint's generation,
+ * and a checkpoint can be written every so often and at the end.
+ * Counting statistics, the run goes a generation at a time and writes
+ * the engine's counts after each. The tiled engine's board may not fit
+ * in memory, so without a checkpoint its rows are streamed out instead.
+ * Only the board goes to stdout, as a pattern file that can be loaded
+ * again; loading reports to stderr.
+ *
+ * @param engine Engine
+ * @param opt Options
+ * @return 0 on success, 1 if the pattern cannot be loaded or the
+ * statistics or last checkpoint cannot be written
+ */
+int runHeadless(Engine *engine, Options *opt){
+  Grid *grid;
+  Cycle cycle;
+  Stats stats;
+  FILE *file;
+  void *state;
+  uint64_t start, end, done, n, every, simulated, h;
+  int x, y, failed, streamed;
+  state = loadState(engine, opt->file, &x, &y, &start);
+  if(state == NULL){
+    return 1;
+  }
+  file = NULL;
+  if(opt->stats != NULL && (file = openStats(opt->stats, opt->binary)) == NULL){
+    engine->destroy(state);
+    return 1;
+  }
+  streamed = engine == &tiledEngine && opt->checkpoint == NULL;
+  grid = streamed ? NULL : allocateGrid(x, y);
+  end = opt->generation + opt->generations;
+  if(opt->cycles){
+    advanceTo(engine, state, opt->generation);
+    simulated = runCycles(engine, state, x, y, opt->generations,
+			  opt->cycles == 2, &cycle);
+    if(cycle.period > 0){
+      printf("%s of period %llu from generation %llu",
+	     cycle.dx || cycle.dy ? "Ship" : "Cycle",
+	     (unsigned long long)cycle.period,
+	     (unsigned long long)(start + opt->generation + cycle.onset));
+      if(cycle.dx || cycle.dy){
+	printf(" moving (%d, %d)", cycle.dx, cycle.dy);
+      }
+      printf(", %llu generations simulated. \n",
+	     (unsigned long long)simulated);
+    }
+  }
+  else{
+    every = opt->checkpoint != NULL ? opt->interval : 0;
+    for(done = 0; done < end; done += n){
+      if(file != NULL){
+	n = 1;
+      }
+      else if(every > 0 && every - done % every < end - done){
+	n = every - done % every;
+      }
+      else{
+	n = end - done;
+      }
+      advanceTo(engine, state, n);
+      if(file != NULL){
+	engine->stats(state, &stats);
+	writeStats(file, opt->binary, start + done + n, &stats);
+      }
+      /* Every interval is kept, so a stopped run loses less than one */
+      if(every > 0 && (done + n) % every == 0 && done + n < end){
+	engine->store(state, grid);
+	saveCheckpoint(opt->checkpoint, grid, start + done + n, opt->compress);
+      }
+    }
+  }
+  if(!streamed){
+    engine->store(state, grid);
+  }
+  failed = file != NULL && fclose(file) != 0;
+  if(failed){
+    printf("Could not write statistics (%s). \n", opt->stats);
+  }
+  failed |= opt->checkpoint != NULL &&
+    saveCheckpoint(opt->checkpoint, grid, start + end, opt->compress);
+  if(streamed && opt->hash){
+    h = FNV_OFFSET;
+    h = (h ^ (uint64_t)x) * FNV_PRIME;
+    h = (h ^ (uint64_t)y) * FNV_PRIME;
+    tiledRows(state, hashRow, &h);
+    printf("%016llx\n", (unsigned long long)h);
+  }
+  else if(streamed){
+    printf("%d %d\n", x, y);
+    tiledRows(state, printRow, stdout);
+  }
+  else if(opt->hash){
+    printf("%016llx\n", (unsigned long long)hashGrid(grid));
+  }
+  else{
+    printGrid(stdout, grid);
+  }
+  engine->destroy(state);
+  if(grid != NULL){
+    freeGrid(grid);
+  }
+  return failed;
+}
+/**
+ * Print a grid in the pattern file format.
+ *
+ * @param out File to print to
+ * @param g Grid
+ */
+void printGrid(FILE *out, Grid *g){
+  int j;
+  fprintf(out, "%d %d\n", g->x, g->y);
+  for(j = 0; j < g->y; j++){
+    printRow(out, g->cells + (size_t)j * g->x, g->x);
+  }
+}
+/**
+ * Print one row of a board in the pattern file format.
+ *
+ * @param arg File to print to
+ * @param cells Cells of the row
+ * @param x Number of cells
+ */
+void printRow(void *arg, char *cells, int x){
+  fwrite(cells, 1, x, (FILE *)arg);
+  fputc('\n', (FILE *)arg);
+}
+/**
+ * FNV-1a hash of a grid's size and cells.
+ * Equal boards hash the same whichever engine made them.
+ *
+ * @param g Grid
+ * @return Hash
+ */
+uint64_t hashGrid(Grid *g){
+  uint64_t h;
+  h = FNV_OFFSET;
+  h = (h ^ (uint64_t)g->x) * FNV_PRIME;
+  h = (h ^ (uint64_t)g->y) * FNV_PRIME;
+  return hashCells(h, g->cells, (size_t)g->x * g->y);
+}
+/**
+ * Carry an FNV-1a hash on over some cells.
+ *
+ * @param h Hash so far
+ * @param cells Cells
+ * @param n Number of cells
+ * @return Hash
+ */
+uint64_t hashCells(uint64_t h, char *cells, size_t n){
+  size_t i;
+  for(i = 0; i < n; i++){
+    h = (h ^ (unsigned char)cells[i]) * FNV_PRIME;
+  }
+  return h;
+}
+/**
+ * Carry a hash on over one row of a board.
+ *
+ * @param arg Hash so far
+ * @param cells Cells of the row
+ * @param x Number of cells
+ */
+void hashRow(void *arg, char *cells, int x){
+  *(uint64_t *)arg = hashCells(*(uint64_t *)arg, cells, x);
+}
+/**
+ * Time every engine on the bundled patterns
+ * and on random soups of growing size. The tiled engine's speed is
+ * also given as a share of the swar engine's, which steps the same
+ * words in memory.
+ *
+ * @return 0
+ */
+int benchmark(void){
+  char *files[] = {"infile0.txt", "infile1.txt", "infile2.txt", NULL};
+  int sizes[] = {64, 256, 1024, 4096, 0};
+  char pattern[64];
+  Grid *g;
+  int f, n, i;
+  printf("%-16s %-10s %14s %16s\n",
+	 "pattern", "engine", "generations/s", "cell updates/s");
+  for(f = 0; files[f] != NULL; f++){
+    g = loadGrid(files[f]);
+    if(g != NULL){
+      benchEngines(g, files[f]);
+      freeGrid(g);
+    }
+  }
+  srand(BENCH_SEED);
+  for(n = 0; sizes[n] != 0; n++){
+    g = allocateGrid(sizes[n], sizes[n]);
+    for(i = 0; i < sizes[n] * sizes[n]; i++){
+      g->cells[i] = rand() % 2 ? ALIVE : DEAD;
+    }
+    sprintf(pattern, "soup %dx%d", sizes[n], sizes[n]);
+    benchEngines(g, pattern);
+    freeGrid(g);
+  }
+  return 0;
+}
+/**
+ * Time every engine on one pattern.
+ *
+ * @param g Pattern
+ * @param pattern Name to report
+ */
+void benchEngines(Grid *g, char *pattern){
+  double rate, swar, tiled;
+  int e;
+  swar = tiled = 0;
+  for(e = 0; engines[e] != NULL; e++){
+    rate = benchEngine(engines[e], g, pattern);
+    if(engines[e] == &swarEngine){
+      swar = rate;
+    }
+    if(engines[e] == &tiledEngine){
+      tiled = rate;
+    }
+  }
+  printf("%-16s %-10s %13.1f%% of swar\n", pattern, "tiled",
+	 100.0 * tiled / swar);
+}
+/**
+ * Time one engine on one pattern.
+ * The generations run are doubled until they take BENCH_SECONDS,
+ * or for HashLife, which may jump far faster, reach BENCH_GENERATIONS.
+ *
+ * @param engine Engine
+ * @param g Pattern
+ * @param pattern Name to report
+ * @return Generations a second
+ */
+double benchEngine(Engine *engine, Grid *g, char *pattern){
+  void *state;
+  uint64_t generations, total, start;
+  double seconds;
+  state = engine->create(g);
+  total = 0;
+  seconds = 0;
+  for(generations = 1; seconds < BENCH_SECONDS &&
+		generations <= BENCH_GENERATIONS; generations *= 2){
+    start = SDL_GetPerformanceCounter();
+    advanceTo(engine, state, generations);
+    seconds += (double)(SDL_GetPerformanceCounter() - start) /
+      SDL_GetPerformanceFrequency();
+    total += generations;
+  }
+  engine->destroy(state);
+  printf("%-16s %-10s %14.4g %16.4g\n", pattern, engine->name,
+	 total / seconds, (double)g->x * g->y * total / seconds);
+  return total / seconds;
+}
+/**
+ * Handle the window's events.
+ * Escape or q quits, space pauses and resumes, s or the right arrow
+ * pauses and steps once, + and - double and halve the speed and
+ * m runs the simulation as fast as it goes. The mouse wheel zooms
+ * in and out at the pointer and dragging with the left button pans,
+ * page up and page down zoom at the middle of the window and home
+ * shows the whole board again.
  *
- * @param iniBoard Board
  * @param sw Window
- * @param rectangle Rectangle
- * @param x Number of rows 
- * @param y Number of columns
- */
-void drawBoard(char iniBoard[MAX_SIZE][MAX_SIZE],
-	      SDL_Simplewin sw, SDL_Rect rectangle, 
-	      int x, int y){
-  int block, i ,j;
-  for(j = 0; j < MAX_SIZE; j++){
-    for(i = 0; i < MAX_SIZE; i++){
-      if(iniBoard[j][i] == DEAD){
-	Neill_SDL_SetDrawColour(&sw, WHITE, WHITE, WHITE);
-      }
-      if(iniBoard[j][i] == ALIVE){
-	Neill_SDL_SetDrawColour(&sw, BLACK, BLACK, BLACK);
-      }
-      if(iniBoard[j][i] == UNFILLED){
-	Neill_SDL_SetDrawColour(&sw, GREY, GREY, GREY);
-      }
-      block = WHEIGHT / y;
-      rectangle.w = block;
-      rectangle.h = block;
-      /* Filled Rectangle */
-      rectangle.x = block * i;
-      rectangle.y = block * j;
-      SDL_RenderFillRect(sw.renderer, &rectangle);
-      /* Unfilled Rectangle */
-      Neill_SDL_SetDrawColour(&sw, GREY, GREY, GREY);
-      rectangle.x = block * i;
-      rectangle.y = block * j;
-      SDL_RenderDrawRect(sw.renderer, &rectangle);
+ * @param view View of the board
+ * @param sim Simulation
+ * @param resume Speed to resume at, kept while paused
+ */
+void readEvents(SDL_Simplewin *sw, View *view, Simulation *sim,
+		double *resume){
+  SDL_Event event;
+  double speed;
+  int px, py;
+  while(SDL_PollEvent(&event)){
+    if(event.type == SDL_QUIT){
+      sw->finished = 1;
+    }
+    if(event.type == SDL_MOUSEWHEEL){
+      SDL_GetMouseState(&px, &py);
+      zoomView(view, event.wheel.y, px, py);
+    }
+    if(event.type == SDL_MOUSEMOTION &&
+       (event.motion.state & SDL_BUTTON_LMASK)){
+      moveView(view, event.motion.xrel, event.motion.yrel);
+    }
+    if(event.type != SDL_KEYDOWN){
+      continue;
+    }
+    speed = getSpeed(sim);
+    switch(event.key.keysym.sym){
+    case SDLK_ESCAPE:
+    case SDLK_q:
+      sw->finished = 1;
+      break;
+    case SDLK_SPACE:
+      if(speed == SPEED_STEP){
+	setSpeed(sim, *resume);
+      }
+      else{
+	*resume = speed;
+	setSpeed(sim, SPEED_STEP);
+      }
+      break;
+    case SDLK_s:
+    case SDLK_RIGHT:
+      if(speed != SPEED_STEP){
+	*resume = speed;
+	setSpeed(sim, SPEED_STEP);
+      }
+      stepSimulation(sim);
+      break;
+    case SDLK_PLUS:
+    case SDLK_EQUALS:
+      if(speed > 0){
+	setSpeed(sim, speed * 2);
+      }
+      break;
+    case SDLK_MINUS:
+      if(speed == SPEED_MAX){
+	setSpeed(sim, DEFAULT_RATE);
+      }
+      else if(speed / 2 >= MINIMUM_RATE){
+	setSpeed(sim, speed / 2);
+      }
+      break;
+    case SDLK_m:
+      setSpeed(sim, SPEED_MAX);
+      break;
+    case SDLK_PAGEUP:
+      zoomView(view, 1, WWIDTH / 2, WHEIGHT / 2);
+      break;
+    case SDLK_PAGEDOWN:
+      zoomView(view, -1, WWIDTH / 2, WHEIGHT / 2);
+      break;
+    case SDLK_HOME:
+      fitView(view);
+      break;
     }
   }
 }
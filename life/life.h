@@ -0,0 +1,204 @@
+/**
+ * @file life.h
+ * @author YAN SUN
+ * @version 1.0
+ *
+ * @section DESCRIPTION
+ * Shared definitions for the Game of Life program.
+ * Every engine stores and steps the board in its own way,
+ * the grid in main is only used to load and draw it.
+ */
+#ifndef LIFE_H
+#define LIFE_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define ALIVE '#'
+#define DEAD '-'
+#define RULE_LENGTH 24
+/* Side of the squares of cells that changes are reported in */
+#define CHANGE_TILE 64
+/* Speeds of the simulation thread other than generations a second */
+#define SPEED_MAX -1.0
+#define SPEED_STEP 0.0
+/* What lies past the edge of a bounded board, see topology.c */
+#define TOPOLOGY_DEAD 0
+#define TOPOLOGY_TORUS 1
+#define TOPOLOGY_KLEIN 2
+/* Cells counted in bytes before they are added up */
+#define COUNT_BLOCK 255
+
+/* A board of any size on the heap, one char per cell, row by row */
+struct grid{
+  int x;
+  int y;
+  char *cells;
+};
+typedef struct grid Grid;
+
+/* Cell i of row j */
+#define CELL(g, i, j) ((g)->cells[(size_t)(j) * (g)->x + (i)])
+
+/* Outer-totalistic rule, bit k set for k neighbours */
+struct rule{
+  int birth;
+  int survive;
+};
+typedef struct rule Rule;
+
+/* Counts of one generation, see stats.c */
+struct stats{
+  uint64_t population;
+  uint64_t births;
+  uint64_t deaths;
+  /* Box round the live cells, -1 when there are none */
+  int left;
+  int top;
+  int right;
+  int bottom;
+};
+typedef struct stats Stats;
+
+/* Counts of one row, kept by an engine as it steps */
+struct rowStats{
+  int population;
+  int births;
+  int deaths;
+  /* First and last live column, -1 when there are none */
+  int left;
+  int right;
+};
+typedef struct rowStats RowStats;
+
+/* One way of storing and stepping the board */
+struct engine{
+  char *name;
+  /* Copy the grid into a new engine state */
+  void *(*create)(Grid *g);
+  /* Advance one generation, or one jump for HashLife */
+  void (*step)(void *state);
+  /* Copy the current generation back into the grid */
+  void (*store)(void *state, Grid *g);
+  void (*destroy)(void *state);
+  /* Advance many generations at once, NULL to step one at a time */
+  void (*jump)(void *state, uint64_t generations);
+  /* Create an engine state of x by y dead cells for the loader */
+  void *(*blank)(int x, int y);
+  /* Make n cells from cell i of row j alive, rows arrive in order */
+  void (*live)(void *state, int i, int j, int n);
+  /* Set to 1 the CHANGE_TILE squares, row by row, changed since they
+     were last asked for, marked as it stepped if lifeChanges was set
+     when the state was created, NULL if the engine cannot tell */
+  void (*changes)(void *state, unsigned char *tiles);
+  /* Copy columns i0 to i1 - 1 of rows j0 to j1 - 1 of the current
+     generation into the grid, NULL if the engine only stores it all */
+  void (*storeArea)(void *state, Grid *g, int i0, int j0, int i1, int j1);
+  /* Set the statistics of the last step, counted as it stepped if
+     lifeStats was set when the state was created, NULL if the engine
+     cannot count */
+  void (*stats)(void *state, Stats *stats);
+  /* 1 if cells off the board stay dead, so the board is everything */
+  int bounded;
+  /* 1 if the edges can wrap round as lifeTopology says */
+  int wraps;
+};
+typedef struct engine Engine;
+
+/* A repeating pattern found by runCycles */
+struct cycle{
+  /* First generation of the cycle, counted from the start of the run */
+  uint64_t onset;
+  /* Generations in the cycle, 0 if none was found */
+  uint64_t period;
+  /* Cells moved each period, 0 for a still life or an oscillator */
+  int dx;
+  int dy;
+};
+typedef struct cycle Cycle;
+
+/* An engine stepping on its own thread, see sim.c */
+typedef struct simulation Simulation;
+
+extern Engine scalarEngine;
+extern Engine swarEngine;
+extern Engine simdEngine;
+extern Engine blockEngine;
+extern Engine tiledEngine;
+extern Engine sparseEngine;
+extern Engine planeEngine;
+extern Engine hashEngine;
+
+extern Rule lifeRule;
+extern int lifeTopology;
+extern int lifeStats;
+extern int lifeChanges;
+
+void ruleInit(char *text);
+void patternRule(char *text);
+int parseRule(char *text, Rule *rule);
+void formatRule(Rule *rule, char *text);
+int isConway(Rule *rule);
+
+void topologyInit(char *text);
+void patternTopology(int topology);
+char *topologyName(int topology);
+void borderBytes(unsigned char *cells, int x, int y, int stride, int j,
+		 int topology);
+void edgeBytes(unsigned char *ghost, const unsigned char *row, int x,
+	       int topology);
+
+void countBytes(const unsigned char *now, const unsigned char *before,
+		int x, unsigned char alive, RowStats *r);
+int lastCell(const unsigned char *cells, int n, unsigned char value);
+void sumRows(const RowStats *rows, int y, Stats *stats);
+FILE *openStats(char *name, int binary);
+void writeStats(FILE *file, int binary, uint64_t generation, Stats *stats);
+
+int changeWords(int x);
+uint64_t *newChanges(int x, int y);
+void markBytes(const unsigned char *now, const unsigned char *before,
+	       int x, uint64_t *marks);
+void markWords(const uint64_t *now, const uint64_t *before, int words,
+	       uint64_t lastMask, uint64_t *marks);
+void sumChanges(uint64_t *marks, int x, int y, unsigned char *tiles);
+
+char *simdInit(char *isa);
+void hashInit(int speed, size_t megabytes);
+void tiledInit(char *directory, size_t megabytes);
+void tiledRows(void *state, void (*row)(void *arg, char *cells, int x),
+	       void *arg);
+
+int poolInit(int threads);
+void poolRun(void (*band)(void *state, uint64_t generation, int row0, int row1),
+	     void *state, int rows, uint64_t generations);
+
+Simulation *startSimulation(Engine *engine, void *state, int x, int y,
+			    double speed);
+Grid *latestGeneration(Simulation *sim, unsigned char **changed);
+void setSpeed(Simulation *sim, double speed);
+double getSpeed(Simulation *sim);
+void stepSimulation(Simulation *sim);
+void stopSimulation(Simulation *sim);
+
+uint64_t runCycles(Engine *engine, void *state, int x, int y,
+		   uint64_t generations, int ships, Cycle *cycle);
+
+uint64_t takeCensus(Engine *engine, uint64_t soups, int soup, uint64_t seed,
+		    uint64_t generations, int threads, int report);
+char *censusNames(Grid *g);
+
+int isCheckpoint(char *name);
+int saveCheckpoint(char *name, Grid *g, uint64_t generation, int compress);
+void *loadCheckpoint(char *name, void *(*blank)(int x, int y),
+		     void (*live)(void *state, int i, int j, int n),
+		     int *x, int *y, uint64_t *generation);
+
+Grid *allocateGrid(int x, int y);
+void freeGrid(Grid *g);
+Grid *loadGrid(char *name);
+void *loadPattern(char *name, void *(*blank)(int x, int y),
+		  void (*live)(void *state, int i, int j, int n), int *x, int *y);
+
+#endif
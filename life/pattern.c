@@ -0,0 +1,356 @@
+/**
+ * @file pattern.c
+ * @author YAN SUN
+ * @version 1.0
+ *
+ * @section DESCRIPTION
+ * Streaming pattern loaders.
+ * Three formats are read: RLE, plaintext .cells, and our own board
+ * files (a "x y" line then rows of '#' and '-'). The format is told
+ * from the first character. The file goes through a fixed buffer and
+ * every run of live cells is handed to the engine as it is parsed,
+ * row by row from the top, so no full-size copy of the board is made.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "life.h"
+
+#define READ_BUFFER 65536
+#define LINE_LENGTH 256
+
+struct reader{
+  FILE *file;
+  char buffer[READ_BUFFER];
+  size_t length;
+  size_t position;
+};
+typedef struct reader Reader;
+
+/* Where the parsed cells go */
+struct sink{
+  void *(*blank)(int x, int y);
+  void (*live)(void *state, int i, int j, int n);
+  void *state;
+  int x;
+  int y;
+};
+typedef struct sink Sink;
+
+static int readChar(Reader *r);
+static int peekChar(Reader *r);
+static int readLine(Reader *r, char *line);
+static void *loadRle(Reader *r, Sink *sink);
+static void *loadCells(Reader *r, Sink *sink);
+static void *loadBoard(Reader *r, Sink *sink);
+static void openSink(Sink *sink, int x, int y);
+static void addRun(Sink *sink, int i, int j, int n);
+
+/**
+ * Load a pattern file into a new engine state.
+ *
+ * @param name File name
+ * @param blank Create a state of x by y dead cells
+ * @param live Make n cells from cell i of row j alive
+ * @param x Set to the number of columns
+ * @param y Set to the number of rows
+ * @return The state, NULL if the file cannot be read
+ */
+void *loadPattern(char *name, void *(*blank)(int x, int y),
+		  void (*live)(void *state, int i, int j, int n), int *x, int *y){
+  Reader *r;
+  Sink sink;
+  void *state;
+  int c;
+  r = (Reader *)malloc(sizeof(Reader));
+  if(r == NULL){
+    printf("Cannot Allocate Reader\n");
+    exit(2);
+  }
+  r->file = fopen(name, "rb");
+  /* fopen returns NULL pointer on failure */
+  if(r->file == NULL){
+    printf("Could not open file. \n");
+    free(r);
+    return NULL;
+  }
+  /* Status goes to stderr, so a headless run's output stays a board */
+  fprintf(stderr, "File (%s) opened. \n", name);
+  r->length = 0;
+  r->position = 0;
+  sink.blank = blank;
+  sink.live = live;
+  sink.state = NULL;
+  c = peekChar(r);
+  if(c == '#' || c == 'x'){
+    state = loadRle(r, &sink);
+  }
+  else if(c == '!' || c == '.' || c == 'O' || c == '*'){
+    state = loadCells(r, &sink);
+  }
+  else{
+    state = loadBoard(r, &sink);
+  }
+  fclose(r->file);
+  free(r);
+  if(state != NULL){
+    fprintf(stderr, "Row: %d Column: %d \n", sink.x, sink.y);
+    *x = sink.x;
+    *y = sink.y;
+  }
+  return state;
+}
+/**
+ * Read an RLE pattern.
+ * '#' lines come first, then "x = <columns>, y = <rows>" and runs of
+ * <count><tag> where b is dead, o (or any other letter) alive, $ ends
+ * a row and ! the pattern. Cells beyond the header's size are dropped.
+ * A rule in the header is used unless one was given on the command
+ * line, so it must be read before the engine is created.
+ *
+ * @param r Reader
+ * @param sink Where the cells go
+ * @return The state, NULL if there is no header
+ */
+static void *loadRle(Reader *r, Sink *sink){
+  char line[LINE_LENGTH], rule[LINE_LENGTH];
+  int x, y, i, j, c, count, n;
+  do{
+    if(readLine(r, line) == EOF){
+      printf("Could not read the RLE header. \n");
+      return NULL;
+    }
+  }while(line[0] == '#');
+  rule[0] = '\0';
+  if(sscanf(line, " x = %d , y = %d , rule = %255s", &x, &y, rule) < 2 ||
+     x < 1 || y < 1){
+    printf("Could not read the RLE header. \n");
+    return NULL;
+  }
+  if(rule[0] != '\0'){
+    patternRule(rule);
+  }
+  openSink(sink, x, y);
+  i = j = count = 0;
+  while((c = readChar(r)) != EOF && c != '!'){
+    if(isdigit(c)){
+      count = count * 10 + c - '0';
+      continue;
+    }
+    if(isspace(c)){
+      continue;
+    }
+    n = count > 0 ? count : 1;
+    count = 0;
+    if(c == '$'){
+      j += n;
+      i = 0;
+    }
+    else if(c == 'b'){
+      i += n;
+    }
+    else if(isalpha(c)){
+      addRun(sink, i, j, n);
+      i += n;
+    }
+  }
+  return sink->state;
+}
+/**
+ * Read a plaintext .cells pattern.
+ * '!' lines are comments, each other line a row of '.' (dead) and
+ * 'O' or '*' (alive). There is no header, so a first pass measures
+ * the rows before a second one reads the cells.
+ *
+ * @param r Reader
+ * @param sink Where the cells go
+ * @return The state, NULL if there are no rows
+ */
+static void *loadCells(Reader *r, Sink *sink){
+  int x, y, i, j, c, start, comment, alive;
+  x = y = i = 0;
+  comment = 0;
+  while((c = readChar(r)) != EOF){
+    if(c == '\n'){
+      y += !comment;
+      i = 0;
+      comment = 0;
+      continue;
+    }
+    if(i == 0 && c == '!'){
+      comment = 1;
+    }
+    if(c != '\r'){
+      i++;
+    }
+    if(!comment && i > x){
+      x = i;
+    }
+  }
+  if(i > 0){
+    y += !comment;
+  }
+  if(x < 1 || y < 1){
+    printf("Could not read any rows. \n");
+    return NULL;
+  }
+  openSink(sink, x, y);
+  rewind(r->file);
+  r->length = 0;
+  r->position = 0;
+  i = j = 0;
+  start = -1;
+  comment = 0;
+  while((c = readChar(r)) != EOF){
+    if(i == 0 && c == '!'){
+      comment = 1;
+    }
+    alive = !comment && (c == 'O' || c == '*');
+    if(alive && start < 0){
+      start = i;
+    }
+    if(!alive && start >= 0){
+      addRun(sink, start, j, i - start);
+      start = -1;
+    }
+    if(c == '\n'){
+      j += !comment;
+      i = 0;
+      comment = 0;
+    }
+    else if(c != '\r'){
+      i++;
+    }
+  }
+  if(start >= 0){
+    addRun(sink, start, j, i - start);
+  }
+  return sink->state;
+}
+/**
+ * Read one of our board files.
+ * The first line holds the number of columns and rows, each following
+ * line one row of '#' (alive) and '-' (dead). A short row or missing
+ * rows are left dead.
+ *
+ * @param r Reader
+ * @param sink Where the cells go
+ * @return The state, NULL if the size cannot be read
+ */
+static void *loadBoard(Reader *r, Sink *sink){
+  char line[LINE_LENGTH];
+  int x, y, i, j, c, start;
+  if(readLine(r, line) == EOF || sscanf(line, "%d %d", &x, &y) != 2 ||
+     x < 1 || y < 1){
+    printf("Could not read the board size. \n");
+    return NULL;
+  }
+  openSink(sink, x, y);
+  i = j = 0;
+  start = -1;
+  while((c = readChar(r)) != EOF && j < y){
+    if(c == ALIVE){
+      if(start < 0){
+	start = i;
+      }
+    }
+    else if(start >= 0){
+      addRun(sink, start, j, i - start);
+      start = -1;
+    }
+    if(c == '\n'){
+      j++;
+      i = 0;
+    }
+    else{
+      i++;
+    }
+  }
+  if(start >= 0){
+    addRun(sink, start, j, i - start);
+  }
+  return sink->state;
+}
+/**
+ * Create the engine state once the size is known.
+ *
+ * @param sink Where the cells go
+ * @param x Number of columns
+ * @param y Number of rows
+ */
+static void openSink(Sink *sink, int x, int y){
+  sink->x = x;
+  sink->y = y;
+  sink->state = sink->blank(x, y);
+}
+/**
+ * Pass a run of live cells on, clipped to the board.
+ *
+ * @param sink Where the cells go
+ * @param i First column of the run
+ * @param j Row
+ * @param n Length of the run
+ */
+static void addRun(Sink *sink, int i, int j, int n){
+  if(j >= sink->y || i >= sink->x){
+    return;
+  }
+  if(n > sink->x - i){
+    n = sink->x - i;
+  }
+  sink->live(sink->state, i, j, n);
+}
+/**
+ * Read the next character through the buffer.
+ *
+ * @param r Reader
+ * @return The character, EOF at the end of the file
+ */
+static int readChar(Reader *r){
+  if(r->position == r->length){
+    r->length = fread(r->buffer, 1, READ_BUFFER, r->file);
+    r->position = 0;
+    if(r->length == 0){
+      return EOF;
+    }
+  }
+  return (unsigned char)r->buffer[r->position++];
+}
+/**
+ * Look at the next character without reading it.
+ *
+ * @param r Reader
+ * @return The character, EOF at the end of the file
+ */
+static int peekChar(Reader *r){
+  int c;
+  c = readChar(r);
+  if(c != EOF){
+    r->position--;
+  }
+  return c;
+}
+/**
+ * Read a line, keeping the first LINE_LENGTH - 1 characters.
+ *
+ * @param r Reader
+ * @param line Line read, without the newline
+ * @return 0, or EOF if the file has ended
+ */
+static int readLine(Reader *r, char *line){
+  int c, n;
+  n = 0;
+  c = readChar(r);
+  if(c == EOF){
+    return EOF;
+  }
+  while(c != '\n' && c != EOF){
+    if(n < LINE_LENGTH - 1 && c != '\r'){
+      line[n++] = c;
+    }
+    c = readChar(r);
+  }
+  line[n] = '\0';
+  return 0;
+}
@@ -0,0 +1,176 @@
+/**
+ * @file pool.c
+ * @author YAN SUN
+ * @version 1.0
+ *
+ * @section DESCRIPTION
+ * Persistent thread pool for banded stepping.
+ * The board's rows are split into one band per thread. Every thread
+ * updates its band from the previous generation's buffer, reading
+ * the rows either side of the band as a halo, then all threads wait
+ * at a barrier before the next generation. The calling thread works
+ * the first band, so one thread runs without any locking at all.
+ * Each cell is calculated exactly as before, only by another thread,
+ * so the result is the same for any number of threads.
+ */
+#define _POSIX_C_SOURCE 200112L
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "life.h"
+
+/* A job of some generations of a band function over the rows */
+struct job{
+  void (*band)(void *state, uint64_t generation, int row0, int row1);
+  void *state;
+  int rows;
+  uint64_t generations;
+};
+typedef struct job Job;
+
+struct pool{
+  int threads;
+  pthread_t *workers;
+  pthread_barrier_t start;
+  pthread_barrier_t done;
+  /* The job every thread runs, band is NULL to stop the threads. Each
+     thread copies it once the job starts, as the caller may set the
+     next one while others are still leaving the last barrier */
+  Job job;
+};
+typedef struct pool Pool;
+
+static void *poolWorker(void *arg);
+static void runBand(Job *job, int worker);
+static void poolStop(void);
+
+static Pool pool = {1, NULL};
+
+/**
+ * Start the pool's threads, replacing any started before.
+ *
+ * @param threads Number of threads, 0 for one per processor
+ * @return Number of threads in use
+ */
+int poolInit(int threads){
+  long i;
+  poolStop();
+  if(threads <= 0){
+    threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+  }
+  if(threads < 1){
+    threads = 1;
+  }
+  pool.threads = threads;
+  if(threads == 1){
+    return 1;
+  }
+  pool.workers = (pthread_t *)malloc(sizeof(pthread_t) * threads);
+  if(pool.workers == NULL ||
+     pthread_barrier_init(&pool.start, NULL, threads) != 0 ||
+     pthread_barrier_init(&pool.done, NULL, threads) != 0){
+    printf("Cannot Start Threads\n");
+    exit(2);
+  }
+  for(i = 1; i < threads; i++){
+    if(pthread_create(&pool.workers[i], NULL, poolWorker, (void *)i) != 0){
+      printf("Cannot Start Threads\n");
+      exit(2);
+    }
+  }
+  return threads;
+}
+/**
+ * Run a number of generations across the pool.
+ * The band function is called for every generation with the rows of
+ * one thread's band, all bands of a generation are finished before
+ * any band of the next one starts.
+ *
+ * @param band Update rows row0 to row1 - 1 for a generation
+ * @param state Engine state
+ * @param rows Number of rows on the board
+ * @param generations Number of generations
+ */
+void poolRun(void (*band)(void *state, uint64_t generation, int row0, int row1),
+	     void *state, int rows, uint64_t generations){
+  Job job;
+  uint64_t g;
+  /* A pool of one thread shares nothing, so engines stepped on other
+     threads, like the census's, can each run through it at once */
+  if(pool.threads == 1){
+    for(g = 0; g < generations; g++){
+      band(state, g, 0, rows);
+    }
+    return;
+  }
+  /* Without a barrier to meet at, the workers could still be copying
+     the job when the next one is set */
+  if(generations == 0){
+    return;
+  }
+  job.band = band;
+  job.state = state;
+  job.rows = rows;
+  job.generations = generations;
+  pool.job = job;
+  pthread_barrier_wait(&pool.start);
+  runBand(&job, 0);
+}
+/**
+ * Wait for jobs and run this thread's band of them.
+ *
+ * @param arg Worker number
+ * @return NULL
+ */
+static void *poolWorker(void *arg){
+  Job job;
+  int worker;
+  worker = (int)(long)arg;
+  for(;;){
+    pthread_barrier_wait(&pool.start);
+    job = pool.job;
+    if(job.band == NULL){
+      return NULL;
+    }
+    runBand(&job, worker);
+  }
+}
+/**
+ * Run one worker's band for every generation of the job,
+ * meeting the others at the barrier after each one.
+ *
+ * @param job This thread's copy of the job
+ * @param worker Worker number
+ */
+static void runBand(Job *job, int worker){
+  uint64_t g;
+  int row0, row1;
+  row0 = (int)((int64_t)job->rows * worker / pool.threads);
+  row1 = (int)((int64_t)job->rows * (worker + 1) / pool.threads);
+  for(g = 0; g < job->generations; g++){
+    if(row0 < row1){
+      job->band(job->state, g, row0, row1);
+    }
+    pthread_barrier_wait(&pool.done);
+  }
+}
+/**
+ * Stop and join the pool's threads.
+ */
+static void poolStop(void){
+  int i;
+  if(pool.threads > 1){
+    pool.job.band = NULL;
+    pthread_barrier_wait(&pool.start);
+    for(i = 1; i < pool.threads; i++){
+      pthread_join(pool.workers[i], NULL);
+    }
+    pthread_barrier_destroy(&pool.start);
+    pthread_barrier_destroy(&pool.done);
+    free(pool.workers);
+    pool.workers = NULL;
+  }
+  pool.threads = 1;
+}
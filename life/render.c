@@ -0,0 +1,440 @@
+/**
+ * @file render.c
+ * @author YAN SUN
+ * @version 1.0
+ *
+ * @section DESCRIPTION
+ * Texture renderer for the board.
+ * The window is a viewport onto the board that can be panned and
+ * zoomed. Zoomed in, the texture holds one pixel per cell shown,
+ * which the renderer scales up to whole blocks. Zoomed out, each pixel
+ * is a square of 2^level cells from a mip pyramid of the density of
+ * live cells, each level a quarter the size of the one below. The
+ * pyramid is only brought up to date for the squares of cells the
+ * simulation reports as changed, and only the pixels showing them are
+ * written and uploaded again. So a frame costs as much as what moved,
+ * and never more than the pixels in the window, whatever the size of
+ * the board. The grid lines do not change while the zoom stays the
+ * same, so they are drawn once into a second texture laid on top.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include "render.h"
+
+#define PIXEL_ALIVE 0xFF000000u
+#define PIXEL_DEAD 0xFFFFFFFFu
+#define PIXEL_LINE 0xFFC0C0C0u
+#define PIXEL_CLEAR 0x00000000u
+/* Taken from a dead pixel for each step of density, a shade of grey */
+#define PIXEL_GREY 0x00010101u
+/* Smallest block with room for a cell inside its grid lines */
+#define GRID_BLOCK 3
+/* Largest block zooming in goes to */
+#define MAX_BLOCK 64
+
+static void placeView(View *v);
+static void eachRun(View *v, Grid *g, unsigned char *changed, int draw);
+static void updateDensity(View *v, Grid *g, int tx0, int tx1, int ty);
+static int squareDensity(View *v, Grid *g, int k, int i, int j);
+static void drawTiles(View *v, Grid *g, int tx0, int tx1, int ty);
+static void drawPixels(View *v, Grid *g, int i0, int j0, int i1, int j1);
+static SDL_Texture *gridTexture(View *v, int block);
+
+/**
+ * Create the textures for an x by y board, and the levels of the
+ * pyramid down to the one where the whole board fits the window.
+ * The view starts fitted to the board.
+ *
+ * @param sw Window
+ * @param x Number of columns
+ * @param y Number of rows
+ * @return The new view
+ */
+View *openView(SDL_Simplewin *sw, int x, int y){
+  View *v;
+  int k;
+  v = (View *)malloc(sizeof(View));
+  if(v == NULL){
+    printf("Cannot Allocate View\n");
+    exit(2);
+  }
+  v->renderer = sw->renderer;
+  v->x = x;
+  v->y = y;
+  for(k = 0; ((x + (1 << k) - 1) >> k) > WWIDTH ||
+	((y + (1 << k) - 1) >> k) > WHEIGHT; k++);
+  v->levels = k;
+  v->density = (unsigned char **)malloc(sizeof(unsigned char *) * (k + 1));
+  v->levelX = (int *)malloc(sizeof(int) * (k + 1));
+  v->levelY = (int *)malloc(sizeof(int) * (k + 1));
+  if(v->density == NULL || v->levelX == NULL || v->levelY == NULL){
+    printf("Cannot Allocate View\n");
+    exit(2);
+  }
+  for(k = 0; k <= v->levels; k++){
+    v->levelX[k] = (x + (1 << k) - 1) >> k;
+    v->levelY[k] = (y + (1 << k) - 1) >> k;
+    /* Level 0 is the board itself */
+    v->density[k] = k == 0 ? NULL :
+      (unsigned char *)calloc((size_t)v->levelX[k] * v->levelY[k], 1);
+    if(k > 0 && v->density[k] == NULL){
+      printf("Cannot Allocate View\n");
+      exit(2);
+    }
+  }
+  v->tilesX = (x + CHANGE_TILE - 1) / CHANGE_TILE;
+  v->tilesY = (y + CHANGE_TILE - 1) / CHANGE_TILE;
+  v->pixels = (Uint32 *)malloc(sizeof(Uint32) * WWIDTH * WHEIGHT);
+  /* Blocks stay sharp-edged when scaled */
+  SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, "nearest");
+  /* A static texture keeps what was uploaded, so parts can be updated */
+  v->cells = SDL_CreateTexture(v->renderer, SDL_PIXELFORMAT_ARGB8888,
+			       SDL_TEXTUREACCESS_STATIC, WWIDTH, WHEIGHT);
+  if(v->pixels == NULL || v->cells == NULL){
+    printf("Cannot Create Texture\n");
+    exit(2);
+  }
+  v->grid = NULL;
+  v->gridBlock = 0;
+  v->dragX = v->dragY = 0;
+  fitView(v);
+  return v;
+}
+/**
+ * Show the whole board from the top left corner, in square blocks of
+ * the largest whole size that fits the window, or at the first level
+ * of the pyramid that fits when even one pixel per cell is too many.
+ *
+ * @param v View
+ */
+void fitView(View *v){
+  v->block = WWIDTH / v->x < WHEIGHT / v->y ? WWIDTH / v->x : WHEIGHT / v->y;
+  v->level = 0;
+  if(v->block < 1){
+    v->block = 1;
+    v->level = v->levels;
+  }
+  v->left = v->top = 0;
+  placeView(v);
+}
+/**
+ * Zoom in or out, keeping the cell under a pixel of the window where
+ * it is. Zooming in halves the level until it reaches the cells, then
+ * doubles the block; zooming out halves the block down to one pixel,
+ * then goes up the pyramid to its last level.
+ *
+ * @param v View
+ * @param steps Steps in, negative for steps out
+ * @param px Column of the pixel
+ * @param py Row of the pixel
+ */
+void zoomView(View *v, int steps, int px, int py){
+  int cx, cy;
+  cx = v->left + ((px / v->block) << v->level);
+  cy = v->top + ((py / v->block) << v->level);
+  for(; steps > 0; steps--){
+    if(v->level > 0){
+      v->level--;
+    }
+    else if(v->block * 2 <= MAX_BLOCK){
+      v->block *= 2;
+    }
+  }
+  for(; steps < 0; steps++){
+    if(v->block > 1){
+      v->block /= 2;
+    }
+    else if(v->level < v->levels){
+      v->level++;
+    }
+  }
+  v->left = cx - ((px / v->block) << v->level);
+  v->top = cy - ((py / v->block) << v->level);
+  v->dragX = v->dragY = 0;
+  placeView(v);
+}
+/**
+ * Pan the board by a number of pixels, right and down for positive
+ * ones. Pixels short of a whole cell are kept for the next move.
+ *
+ * @param v View
+ * @param dx Pixels across
+ * @param dy Pixels down
+ */
+void moveView(View *v, int dx, int dy){
+  v->dragX += dx;
+  v->dragY += dy;
+  v->left -= v->dragX / v->block * (1 << v->level);
+  v->top -= v->dragY / v->block * (1 << v->level);
+  v->dragX %= v->block;
+  v->dragY %= v->block;
+  placeView(v);
+}
+/**
+ * Keep the view on the board and on whole squares of its level, and
+ * size the texture and grid lines to match. The view is drawn again
+ * in full on the next frame.
+ *
+ * @param v View
+ */
+static void placeView(View *v){
+  int most;
+  most = v->x - ((WWIDTH / v->block) << v->level);
+  v->left = v->left > most ? most : v->left;
+  v->left = v->left < 0 ? 0 : v->left;
+  most = v->y - ((WHEIGHT / v->block) << v->level);
+  v->top = v->top > most ? most : v->top;
+  v->top = v->top < 0 ? 0 : v->top;
+  v->left -= v->left % (1 << v->level);
+  v->top -= v->top % (1 << v->level);
+  v->w = (WWIDTH + v->block - 1) / v->block;
+  most = v->levelX[v->level] - (v->left >> v->level);
+  v->w = v->w < most ? v->w : most;
+  v->h = (WHEIGHT + v->block - 1) / v->block;
+  most = v->levelY[v->level] - (v->top >> v->level);
+  v->h = v->h < most ? v->h : most;
+  v->area.x = 0;
+  v->area.y = 0;
+  v->area.w = v->w * v->block;
+  v->area.h = v->h * v->block;
+  if(v->grid != NULL && v->gridBlock != v->block){
+    SDL_DestroyTexture(v->grid);
+    v->grid = NULL;
+  }
+  if(v->grid == NULL && v->block >= GRID_BLOCK){
+    v->grid = gridTexture(v, v->block);
+    v->gridBlock = v->block;
+  }
+  v->moved = 1;
+}
+/**
+ * Draw the grid lines once into a texture covering the window.
+ * Each block gets a one pixel outline, as a rectangle drawn round it.
+ *
+ * @param v View
+ * @param block Size of a block in pixels
+ * @return The texture
+ */
+static SDL_Texture *gridTexture(View *v, int block){
+  SDL_Texture *t;
+  Uint32 *pixels;
+  int i, j, a, b, w, h;
+  w = (WWIDTH / block + 1) * block;
+  h = (WHEIGHT / block + 1) * block;
+  pixels = (Uint32 *)malloc(sizeof(Uint32) * w * h);
+  t = SDL_CreateTexture(v->renderer, SDL_PIXELFORMAT_ARGB8888,
+			SDL_TEXTUREACCESS_STATIC, w, h);
+  if(pixels == NULL || t == NULL){
+    printf("Cannot Create Texture\n");
+    exit(2);
+  }
+  for(j = 0; j < h; j++){
+    b = j % block;
+    for(i = 0; i < w; i++){
+      a = i % block;
+      pixels[(size_t)j * w + i] =
+	a == 0 || a == block - 1 || b == 0 || b == block - 1 ?
+	PIXEL_LINE : PIXEL_CLEAR;
+    }
+  }
+  SDL_UpdateTexture(t, NULL, pixels, w * sizeof(Uint32));
+  SDL_SetTextureBlendMode(t, SDL_BLENDMODE_BLEND);
+  free(pixels);
+  return t;
+}
+/**
+ * Draw the board. The pyramid is brought up to date over every changed
+ * square first, then the pixels showing them are written and uploaded,
+ * or every pixel if the view has moved. Then the texture and the grid
+ * lines are copied into the window.
+ *
+ * @param v View
+ * @param g Board, the size the view was opened for
+ * @param changed Squares changed since the last board drawn, row by
+ * row, NULL if none
+ */
+void drawView(View *v, Grid *g, unsigned char *changed){
+  SDL_Rect shown;
+  if(changed != NULL){
+    eachRun(v, g, changed, 0);
+    if(!v->moved){
+      eachRun(v, g, changed, 1);
+    }
+  }
+  if(v->moved){
+    drawPixels(v, g, 0, 0, v->w, v->h);
+    v->moved = 0;
+  }
+  shown.x = shown.y = 0;
+  shown.w = v->w;
+  shown.h = v->h;
+  SDL_RenderCopy(v->renderer, v->cells, &shown, &v->area);
+  if(v->grid != NULL){
+    SDL_RenderCopy(v->renderer, v->grid, &v->area, &v->area);
+  }
+}
+/**
+ * Go through the runs of changed squares along each row of squares.
+ *
+ * @param v View
+ * @param g Board
+ * @param changed Squares changed, row by row
+ * @param draw 1 to draw each run, 0 to update the pyramid over it
+ */
+static void eachRun(View *v, Grid *g, unsigned char *changed, int draw){
+  int tx, ty, start;
+  for(ty = 0; ty < v->tilesY; ty++){
+    for(tx = 0; tx < v->tilesX; tx = start){
+      for(; tx < v->tilesX && !changed[ty * v->tilesX + tx]; tx++);
+      for(start = tx; start < v->tilesX &&
+	    changed[ty * v->tilesX + start]; start++);
+      if(start > tx && draw){
+	drawTiles(v, g, tx, start, ty);
+      }
+      else if(start > tx){
+	updateDensity(v, g, tx, start, ty);
+      }
+    }
+  }
+}
+/**
+ * Work out again the squares of every level that cover a run of
+ * changed squares of cells, each level from the one below.
+ *
+ * @param v View
+ * @param g Board
+ * @param tx0 First square of the run
+ * @param tx1 Square after the run
+ * @param ty Row of squares
+ */
+static void updateDensity(View *v, Grid *g, int tx0, int tx1, int ty){
+  int k, i, j, x0, x1, y0, y1;
+  x0 = tx0 * CHANGE_TILE;
+  x1 = tx1 * CHANGE_TILE < v->x ? tx1 * CHANGE_TILE : v->x;
+  y0 = ty * CHANGE_TILE;
+  y1 = (ty + 1) * CHANGE_TILE < v->y ? (ty + 1) * CHANGE_TILE : v->y;
+  for(k = 1; k <= v->levels; k++){
+    for(j = y0 >> k; j <= (y1 - 1) >> k; j++){
+      for(i = x0 >> k; i <= (x1 - 1) >> k; i++){
+	v->density[k][(size_t)j * v->levelX[k] + i] = squareDensity(v, g, k, i, j);
+      }
+    }
+  }
+}
+/**
+ * Density of one square of a level, the mean of the four squares of
+ * the level below it. Squares off the board count as dead.
+ *
+ * @param v View
+ * @param g Board
+ * @param k Level
+ * @param i Column of the square
+ * @param j Row of the square
+ * @return Density, 0 to 255
+ */
+static int squareDensity(View *v, Grid *g, int k, int i, int j){
+  int a, b, sum, column, row;
+  sum = 0;
+  for(b = 0; b < 2; b++){
+    for(a = 0; a < 2; a++){
+      column = 2 * i + a;
+      row = 2 * j + b;
+      if(column >= v->levelX[k - 1] || row >= v->levelY[k - 1]){
+	continue;
+      }
+      if(k == 1){
+	sum += CELL(g, column, row) == ALIVE ? 255 : 0;
+      }
+      else{
+	sum += v->density[k - 1][(size_t)row * v->levelX[k - 1] + column];
+      }
+    }
+  }
+  return (sum + 2) / 4;
+}
+/**
+ * Draw the pixels showing a run of changed squares, if any are in view.
+ *
+ * @param v View
+ * @param g Board
+ * @param tx0 First square of the run
+ * @param tx1 Square after the run
+ * @param ty Row of squares
+ */
+static void drawTiles(View *v, Grid *g, int tx0, int tx1, int ty){
+  int i0, i1, j0, j1, end;
+  i0 = ((tx0 * CHANGE_TILE) >> v->level) - (v->left >> v->level);
+  end = tx1 * CHANGE_TILE < v->x ? tx1 * CHANGE_TILE : v->x;
+  i1 = ((end - 1) >> v->level) + 1 - (v->left >> v->level);
+  j0 = ((ty * CHANGE_TILE) >> v->level) - (v->top >> v->level);
+  end = (ty + 1) * CHANGE_TILE < v->y ? (ty + 1) * CHANGE_TILE : v->y;
+  j1 = ((end - 1) >> v->level) + 1 - (v->top >> v->level);
+  i0 = i0 < 0 ? 0 : i0;
+  j0 = j0 < 0 ? 0 : j0;
+  i1 = i1 > v->w ? v->w : i1;
+  j1 = j1 > v->h ? v->h : j1;
+  if(i0 < i1 && j0 < j1){
+    drawPixels(v, g, i0, j0, i1, j1);
+  }
+}
+/**
+ * Write a rectangle of texture pixels from the cells or the pyramid,
+ * and upload it.
+ *
+ * @param v View
+ * @param g Board
+ * @param i0 First column of pixels
+ * @param j0 First row of pixels
+ * @param i1 Column after the last
+ * @param j1 Row after the last
+ */
+static void drawPixels(View *v, Grid *g, int i0, int j0, int i1, int j1){
+  SDL_Rect rect;
+  Uint32 *out;
+  unsigned char *density;
+  char *cells;
+  int i, j;
+  for(j = j0; j < j1; j++){
+    out = v->pixels + (size_t)j * WWIDTH;
+    if(v->level == 0){
+      cells = g->cells + (size_t)(v->top + j) * g->x + v->left;
+      for(i = i0; i < i1; i++){
+	out[i] = cells[i] == ALIVE ? PIXEL_ALIVE : PIXEL_DEAD;
+      }
+    }
+    else{
+      density = v->density[v->level] +
+	(size_t)((v->top >> v->level) + j) * v->levelX[v->level] +
+	(v->left >> v->level);
+      for(i = i0; i < i1; i++){
+	out[i] = PIXEL_DEAD - PIXEL_GREY * density[i];
+      }
+    }
+  }
+  rect.x = i0;
+  rect.y = j0;
+  rect.w = i1 - i0;
+  rect.h = j1 - j0;
+  SDL_UpdateTexture(v->cells, &rect, v->pixels + (size_t)j0 * WWIDTH + i0,
+		    WWIDTH * sizeof(Uint32));
+}
+/**
+ * Free the view and its textures.
+ *
+ * @param v View
+ */
+void closeView(View *v){
+  int k;
+  SDL_DestroyTexture(v->cells);
+  if(v->grid != NULL){
+    SDL_DestroyTexture(v->grid);
+  }
+  for(k = 1; k <= v->levels; k++){
+    free(v->density[k]);
+  }
+  free(v->density);
+  free(v->levelX);
+  free(v->levelY);
+  free(v->pixels);
+  free(v);
+}
@@ -0,0 +1,62 @@
+/**
+ * @file render.h
+ * @author YAN SUN
+ * @version 1.0
+ *
+ * @section DESCRIPTION
+ * Drawing the board into the window through textures.
+ */
+#ifndef RENDER_H
+#define RENDER_H
+
+#include "neillsdl2.h"
+#include "life.h"
+
+/* The board's textures and the part of the board they show */
+struct view{
+  SDL_Renderer *renderer;
+  int x;
+  int y;
+  /* Pixels a cell is drawn as across, 1 when zoomed out */
+  int block;
+  /* Mip level shown, each pixel a square 2^level cells across, 0 when
+     zoomed in */
+  int level;
+  /* Last mip level, the first the whole board fits the window at */
+  int levels;
+  /* Density of live cells, 0 to 255, of each square of each level from
+     1 up, row by row, and the squares across and down each level */
+  unsigned char **density;
+  int *levelX;
+  int *levelY;
+  /* Top left cell shown, a whole square of the level shown */
+  int left;
+  int top;
+  /* Pixels dragged that do not yet make a whole cell */
+  int dragX;
+  int dragY;
+  /* Set when the view has moved, so every pixel is drawn again */
+  int moved;
+  /* Texture pixels across and down that show the board */
+  int w;
+  int h;
+  int tilesX;
+  int tilesY;
+  /* Copy of the texture's pixels, only changed squares are rewritten */
+  Uint32 *pixels;
+  SDL_Rect area;
+  SDL_Texture *cells;
+  /* Grid lines over the cells, NULL when the cells are too small */
+  SDL_Texture *grid;
+  int gridBlock;
+};
+typedef struct view View;
+
+View *openView(SDL_Simplewin *sw, int x, int y);
+void drawView(View *v, Grid *g, unsigned char *changed);
+void fitView(View *v);
+void zoomView(View *v, int steps, int px, int py);
+void moveView(View *v, int dx, int dy);
+void closeView(View *v);
+
+#endif
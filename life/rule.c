@@ -0,0 +1,161 @@
+/**
+ * @file rule.c
+ * @author YAN SUN
+ * @version 1.0
+ *
+ * @section DESCRIPTION
+ * Outer-totalistic B/S rules.
+ * A rule is two 9-bit masks: bit k of birth is set when a dead cell
+ * with k neighbours comes alive, bit k of survive when a live one
+ * stays alive. Each engine compiles the rule into its own table when
+ * it is created. Rules with B0 are refused, since they would bring
+ * the endless dead plane around the board to life.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "life.h"
+
+#define CONWAY_BIRTH (1 << 3)
+#define CONWAY_SURVIVE ((1 << 2) | (1 << 3))
+
+static int readCounts(char **text);
+
+/* Rule of the engines created from now on */
+Rule lifeRule = {CONWAY_BIRTH, CONWAY_SURVIVE};
+
+/* Set when the rule came from the command line */
+static int ruleFixed = 0;
+
+/**
+ * Set the rule from the command line, it then wins over any rule
+ * in a pattern file. Exit if it cannot be read.
+ *
+ * @param text Rule such as "B36/S23" or "23/36", NULL for Conway's
+ */
+void ruleInit(char *text){
+  if(text == NULL){
+    return;
+  }
+  if(!parseRule(text, &lifeRule)){
+    printf("Unknown rule (%s). \n", text);
+    exit(1);
+  }
+  ruleFixed = 1;
+}
+/**
+ * Set the rule given in a pattern file's header,
+ * unless one was given on the command line.
+ *
+ * @param text Rule
+ */
+void patternRule(char *text){
+  char name[RULE_LENGTH];
+  if(ruleFixed){
+    return;
+  }
+  if(!parseRule(text, &lifeRule)){
+    formatRule(&lifeRule, name);
+    printf("Rule (%s) is not supported, using %s. \n", text, name);
+  }
+}
+/**
+ * Read a rule as B<counts>/S<counts>, S<counts>/B<counts> or the
+ * older <survive>/<birth>. Letters may be either case and the slash
+ * may be left out between B and S parts.
+ *
+ * @param text Rule
+ * @param rule Set to the rule when it can be read
+ * @return 1 if the rule was read, 0 otherwise
+ */
+int parseRule(char *text, Rule *rule){
+  Rule r;
+  char first;
+  first = toupper((unsigned char)text[0]);
+  if(first == 'B' || first == 'S'){
+    text++;
+    if(first == 'B'){
+      r.birth = readCounts(&text);
+    }
+    else{
+      r.survive = readCounts(&text);
+    }
+    if(*text == '/'){
+      text++;
+    }
+    if(toupper((unsigned char)*text) != (first == 'B' ? 'S' : 'B')){
+      return 0;
+    }
+    text++;
+    if(first == 'B'){
+      r.survive = readCounts(&text);
+    }
+    else{
+      r.birth = readCounts(&text);
+    }
+  }
+  else{
+    r.survive = readCounts(&text);
+    if(*text != '/'){
+      return 0;
+    }
+    text++;
+    r.birth = readCounts(&text);
+  }
+  if(*text != '\0' || r.birth < 0 || r.survive < 0 || r.birth & 1){
+    return 0;
+  }
+  *rule = r;
+  return 1;
+}
+/**
+ * Read a run of neighbour counts into a mask.
+ *
+ * @param text Text, moved past the counts
+ * @return Mask, -1 if a count is 9
+ */
+static int readCounts(char **text){
+  int mask;
+  mask = 0;
+  while(isdigit((unsigned char)**text)){
+    if(**text == '9'){
+      return -1;
+    }
+    mask |= 1 << (**text - '0');
+    (*text)++;
+  }
+  return mask;
+}
+/**
+ * Write a rule as B<counts>/S<counts>.
+ *
+ * @param rule Rule
+ * @param text At least RULE_LENGTH characters
+ */
+void formatRule(Rule *rule, char *text){
+  int k;
+  *text++ = 'B';
+  for(k = 0; k <= 8; k++){
+    if(rule->birth & 1 << k){
+      *text++ = '0' + k;
+    }
+  }
+  *text++ = '/';
+  *text++ = 'S';
+  for(k = 0; k <= 8; k++){
+    if(rule->survive & 1 << k){
+      *text++ = '0' + k;
+    }
+  }
+  *text = '\0';
+}
+/**
+ * Whether a rule is Conway's B3/S23, which has its own kernels.
+ *
+ * @param rule Rule
+ * @return 1 for Conway's rule, 0 otherwise
+ */
+int isConway(Rule *rule){
+  return rule->birth == CONWAY_BIRTH && rule->survive == CONWAY_SURVIVE;
+}
@@ -0,0 +1,243 @@
+/**
+ * @file scalar.c
+ * @author YAN SUN
+ * @version 1.0
+ *
+ * @section DESCRIPTION
+ * Reference Game of Life engine, one char per cell.
+ * The board is kept in two buffers that take turns: each generation
+ * is read from one and written to the other in a single pass. The
+ * next state comes from a table indexed by the cell and the count of
+ * its neighbours, so there is no array of counts and no second pass.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "life.h"
+
+struct scalar{
+  int x;
+  int y;
+  int stride;
+  int topology;
+  /* Next state of a dead or live cell by its number of neighbours */
+  char rule[2][9];
+  char *cells;
+  char *next;
+  /* Counts of each row in the last step, NULL when not counting */
+  RowStats *rows;
+  /* Squares each row changed, NULL when not marking */
+  uint64_t *changes;
+};
+typedef struct scalar Scalar;
+
+static void *scalarCreate(Grid *g);
+static void *scalarBlank(int x, int y);
+static void scalarLive(void *state, int i, int j, int n);
+static void scalarStep(void *state);
+static void scalarStore(void *state, Grid *g);
+static void scalarStoreArea(void *state, Grid *g, int i0, int j0,
+			    int i1, int j1);
+static void scalarDestroy(void *state);
+static void scalarChanges(void *state, unsigned char *tiles);
+static void scalarStats(void *state, Stats *stats);
+static void nextGen(Scalar *s, int j);
+
+Engine scalarEngine = {"scalar", scalarCreate, scalarStep,
+		       scalarStore, scalarDestroy, NULL,
+		       scalarBlank, scalarLive, scalarChanges,
+		       scalarStoreArea, scalarStats, 1, 1};
+
+/**
+ * Copy the grid into a new scalar engine.
+ *
+ * @param g Grid
+ * @return The new engine state
+ */
+static void *scalarCreate(Grid *g){
+  Scalar *s;
+  int j;
+  s = (Scalar *)scalarBlank(g->x, g->y);
+  for(j = 0; j < g->y; j++){
+    memcpy(s->cells + (size_t)(j + 1) * s->stride + 1,
+	   g->cells + (size_t)j * g->x, g->x);
+  }
+  return s;
+}
+/**
+ * Create a scalar engine with every cell dead.
+ * Both buffers have a border of ghost cells around the board, so the
+ * neighbours of an edge cell can be read without a check. The border
+ * is dead unless the edges wrap. The rule table and the topology are
+ * taken from the current ones, rows are counted if lifeStats is set
+ * and their changed squares marked if lifeChanges is.
+ *
+ * @param x Number of columns
+ * @param y Number of rows
+ * @return The new engine state
+ */
+static void *scalarBlank(int x, int y){
+  Scalar *s;
+  int k;
+  s = (Scalar *)malloc(sizeof(Scalar));
+  if(s == NULL){
+    printf("Cannot Allocate Engine\n");
+    exit(2);
+  }
+  s->x = x;
+  s->y = y;
+  s->stride = x + 2;
+  s->topology = lifeTopology;
+  for(k = 0; k <= 8; k++){
+    s->rule[0][k] = lifeRule.birth & 1 << k ? ALIVE : DEAD;
+    s->rule[1][k] = lifeRule.survive & 1 << k ? ALIVE : DEAD;
+  }
+  s->cells = (char *)malloc((size_t)(y + 2) * s->stride);
+  s->next = (char *)malloc((size_t)(y + 2) * s->stride);
+  if(s->cells == NULL || s->next == NULL){
+    printf("Cannot Allocate Engine\n");
+    exit(2);
+  }
+  s->rows = lifeStats ? (RowStats *)calloc(y, sizeof(RowStats)) : NULL;
+  if(lifeStats && s->rows == NULL){
+    printf("Cannot Allocate Engine\n");
+    exit(2);
+  }
+  s->changes = newChanges(x, y);
+  memset(s->cells, DEAD, (size_t)(y + 2) * s->stride);
+  memset(s->next, DEAD, (size_t)(y + 2) * s->stride);
+  return s;
+}
+/**
+ * Make a run of cells alive.
+ *
+ * @param state Engine state
+ * @param i First column of the run
+ * @param j Row
+ * @param n Length of the run
+ */
+static void scalarLive(void *state, int i, int j, int n){
+  Scalar *s;
+  s = (Scalar *)state;
+  memset(s->cells + (size_t)(j + 1) * s->stride + 1 + i, ALIVE, n);
+}
+/**
+ * Fill the border for the edges' topology, calculate the next
+ * generation a row at a time, then swap the two buffers.
+ *
+ * @param state Engine state
+ */
+static void scalarStep(void *state){
+  Scalar *s;
+  char *temp;
+  int j;
+  s = (Scalar *)state;
+  for(j = 1; j <= s->y && s->topology != TOPOLOGY_DEAD; j++){
+    borderBytes((unsigned char *)s->cells, s->x, s->y, s->stride, j,
+		s->topology);
+  }
+  for(j = 0; j < s->y; j++){
+    nextGen(s, j);
+  }
+  temp = s->cells;
+  s->cells = s->next;
+  s->next = temp;
+}
+/**
+ * Calculate the next generation of one row.
+ * Count the neighbours of every cell in the current buffer
+ * and look its next state up in the rule table, then count the row
+ * and mark its changes while it is still in the cache.
+ *
+ * @param s Engine state
+ * @param j Row
+ */
+static void nextGen(Scalar *s, int j){
+  char *up, *row, *down, *out;
+  int count, i;
+  row = s->cells + (size_t)(j + 1) * s->stride + 1;
+  up = row - s->stride;
+  down = row + s->stride;
+  out = s->next + (size_t)(j + 1) * s->stride + 1;
+  for(i = 0; i < s->x; i++){
+    count = (up[i-1] == ALIVE) + (up[i] == ALIVE) + (up[i+1] == ALIVE) +
+      (row[i-1] == ALIVE) + (row[i+1] == ALIVE) +
+      (down[i-1] == ALIVE) + (down[i] == ALIVE) + (down[i+1] == ALIVE);
+    out[i] = s->rule[row[i] == ALIVE][count];
+  }
+  if(s->rows != NULL){
+    countBytes((unsigned char *)out, (unsigned char *)row, s->x, ALIVE,
+	       &s->rows[j]);
+  }
+  if(s->changes != NULL){
+    markBytes((unsigned char *)out, (unsigned char *)row, s->x,
+	      s->changes + (size_t)j * changeWords(s->x));
+  }
+}
+/**
+ * Copy the scalar engine's board out.
+ *
+ * @param state Engine state
+ * @param g Grid
+ */
+static void scalarStore(void *state, Grid *g){
+  Scalar *s;
+  s = (Scalar *)state;
+  scalarStoreArea(state, g, 0, 0, s->x, s->y);
+}
+/**
+ * Copy part of the scalar engine's board out.
+ *
+ * @param state Engine state
+ * @param g Grid
+ * @param i0 First column
+ * @param j0 First row
+ * @param i1 Column after the area
+ * @param j1 Row after the area
+ */
+static void scalarStoreArea(void *state, Grid *g, int i0, int j0,
+			    int i1, int j1){
+  Scalar *s;
+  int j;
+  s = (Scalar *)state;
+  for(j = j0; j < j1; j++){
+    memcpy(g->cells + (size_t)j * g->x + i0,
+	   s->cells + (size_t)(j + 1) * s->stride + 1 + i0, i1 - i0);
+  }
+}
+/**
+ * Set the squares changed since they were last asked for.
+ *
+ * @param state Engine state
+ * @param tiles Squares, set to 1 where cells changed
+ */
+static void scalarChanges(void *state, unsigned char *tiles){
+  Scalar *s;
+  s = (Scalar *)state;
+  sumChanges(s->changes, s->x, s->y, tiles);
+}
+/**
+ * Sum the counts of the rows from the last step.
+ *
+ * @param state Engine state
+ * @param stats Set to the statistics
+ */
+static void scalarStats(void *state, Stats *stats){
+  Scalar *s;
+  s = (Scalar *)state;
+  sumRows(s->rows, s->y, stats);
+}
+/**
+ * Free the scalar engine.
+ *
+ * @param state Engine state
+ */
+static void scalarDestroy(void *state){
+  Scalar *s;
+  s = (Scalar *)state;
+  free(s->cells);
+  free(s->next);
+  free(s->rows);
+  free(s->changes);
+  free(s);
+}
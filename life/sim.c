@@ -0,0 +1,373 @@
+/**
+ * @file sim.c
+ * @author YAN SUN
+ * @version 1.0
+ *
+ * @section DESCRIPTION
+ * Simulation thread for the window.
+ * The engine runs on a thread of its own and publishes generations
+ * through three grids: the simulation stores into the back grid and
+ * swaps it with the middle one, the window swaps the middle grid with
+ * the front one when a newer generation is there and draws the front.
+ * Neither side waits for the other beyond the swap, so drawing never
+ * slows the simulation and the simulation never holds up a frame.
+ * Running flat out, a generation is only stored when the last one
+ * has been taken, so the copy costs at most one per frame.
+ * Each grid carries the squares that changed since the grid before
+ * it, gathered from the engine after every step, so the window only
+ * redraws what moved. Each grid also knows the squares that changed
+ * since it was last stored into, and only those are stored again
+ * when the engine can store part of its board.
+ */
+#define _POSIX_C_SOURCE 200112L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include "life.h"
+
+#define NANOSECONDS 1000000000L
+
+struct simulation{
+  Engine *engine;
+  void *state;
+  pthread_t thread;
+  pthread_mutex_t lock;
+  pthread_cond_t wake;
+  Grid *grid[3];
+  /* Squares changed since the grid before, and since the last publish */
+  unsigned char *changed[3];
+  unsigned char *pending;
+  /* Squares each grid is behind the engine by */
+  unsigned char *stale[3];
+  size_t tiles;
+  int tilesX;
+  int tilesY;
+  /* Grids written by the simulation, waiting and shown */
+  int back;
+  int middle;
+  int front;
+  /* Set when the middle grid is newer than the front */
+  int fresh;
+  /* Generations a second, SPEED_MAX or SPEED_STEP */
+  double speed;
+  int steps;
+  int stop;
+};
+
+static void *simulate(void *arg);
+static void publish(Simulation *sim);
+static void storeStale(Simulation *sim, int g);
+static void waitUntil(Simulation *sim, struct timespec *when);
+
+/**
+ * Start stepping an engine on its own thread.
+ *
+ * @param engine Engine
+ * @param state Engine state, left to the simulation until it stops
+ * @param x Number of columns
+ * @param y Number of rows
+ * @param speed Generations a second, SPEED_MAX or SPEED_STEP
+ * @return The simulation
+ */
+Simulation *startSimulation(Engine *engine, void *state, int x, int y,
+			    double speed){
+  Simulation *sim;
+  int i;
+  sim = (Simulation *)malloc(sizeof(Simulation));
+  if(sim == NULL){
+    printf("Cannot Allocate Simulation\n");
+    exit(2);
+  }
+  sim->engine = engine;
+  sim->state = state;
+  sim->tilesX = (x + CHANGE_TILE - 1) / CHANGE_TILE;
+  sim->tilesY = (y + CHANGE_TILE - 1) / CHANGE_TILE;
+  sim->tiles = (size_t)sim->tilesX * sim->tilesY;
+  for(i = 0; i < 3; i++){
+    sim->grid[i] = allocateGrid(x, y);
+    sim->changed[i] = (unsigned char *)calloc(sim->tiles, 1);
+    sim->stale[i] = (unsigned char *)malloc(sim->tiles);
+    if(sim->changed[i] == NULL || sim->stale[i] == NULL){
+      printf("Cannot Allocate Simulation\n");
+      exit(2);
+    }
+    memset(sim->stale[i], 1, sim->tiles);
+  }
+  sim->pending = (unsigned char *)calloc(sim->tiles, 1);
+  if(sim->pending == NULL){
+    printf("Cannot Allocate Simulation\n");
+    exit(2);
+  }
+  sim->back = 0;
+  sim->middle = 1;
+  sim->front = 2;
+  /* The first grid is waiting with every square to draw, and the
+     marks the engine made before it was stored are not wanted */
+  engine->store(state, sim->grid[sim->middle]);
+  memset(sim->stale[sim->middle], 0, sim->tiles);
+  if(engine->changes != NULL){
+    engine->changes(state, sim->pending);
+    memset(sim->pending, 0, sim->tiles);
+  }
+  memset(sim->changed[sim->middle], 1, sim->tiles);
+  sim->fresh = 1;
+  sim->speed = speed;
+  sim->steps = 0;
+  sim->stop = 0;
+  if(pthread_mutex_init(&sim->lock, NULL) != 0 ||
+     pthread_cond_init(&sim->wake, NULL) != 0 ||
+     pthread_create(&sim->thread, NULL, simulate, sim) != 0){
+    printf("Cannot Start Threads\n");
+    exit(2);
+  }
+  return sim;
+}
+/**
+ * The newest generation published, for the window to draw.
+ * The grid stays as it is until the next call.
+ *
+ * @param sim Simulation
+ * @param changed Set to the squares changed since the grid returned
+ * last time, row by row, or NULL if it is the same grid
+ * @return The grid
+ */
+Grid *latestGeneration(Simulation *sim, unsigned char **changed){
+  int temp;
+  *changed = NULL;
+  pthread_mutex_lock(&sim->lock);
+  if(sim->fresh){
+    temp = sim->front;
+    sim->front = sim->middle;
+    sim->middle = temp;
+    sim->fresh = 0;
+    *changed = sim->changed[sim->front];
+  }
+  pthread_mutex_unlock(&sim->lock);
+  return sim->grid[sim->front];
+}
+/**
+ * Change the speed of the simulation.
+ *
+ * @param sim Simulation
+ * @param speed Generations a second, SPEED_MAX or SPEED_STEP
+ */
+void setSpeed(Simulation *sim, double speed){
+  pthread_mutex_lock(&sim->lock);
+  sim->speed = speed;
+  sim->steps = 0;
+  pthread_cond_signal(&sim->wake);
+  pthread_mutex_unlock(&sim->lock);
+}
+/**
+ * The speed of the simulation.
+ *
+ * @param sim Simulation
+ * @return Generations a second, SPEED_MAX or SPEED_STEP
+ */
+double getSpeed(Simulation *sim){
+  double speed;
+  pthread_mutex_lock(&sim->lock);
+  speed = sim->speed;
+  pthread_mutex_unlock(&sim->lock);
+  return speed;
+}
+/**
+ * Advance a stepping simulation by one step.
+ *
+ * @param sim Simulation
+ */
+void stepSimulation(Simulation *sim){
+  pthread_mutex_lock(&sim->lock);
+  if(sim->speed == SPEED_STEP){
+    sim->steps++;
+    pthread_cond_signal(&sim->wake);
+  }
+  pthread_mutex_unlock(&sim->lock);
+}
+/**
+ * Stop the simulation thread and free the grids.
+ * The engine state is the caller's again.
+ *
+ * @param sim Simulation
+ */
+void stopSimulation(Simulation *sim){
+  int i;
+  pthread_mutex_lock(&sim->lock);
+  sim->stop = 1;
+  pthread_cond_signal(&sim->wake);
+  pthread_mutex_unlock(&sim->lock);
+  pthread_join(sim->thread, NULL);
+  pthread_mutex_destroy(&sim->lock);
+  pthread_cond_destroy(&sim->wake);
+  for(i = 0; i < 3; i++){
+    freeGrid(sim->grid[i]);
+    free(sim->changed[i]);
+    free(sim->stale[i]);
+  }
+  free(sim->pending);
+  free(sim);
+}
+/**
+ * Step the engine until stopped, at the chosen speed.
+ * A paced run keeps to a timetable from the last speed change, so
+ * a slow generation is caught up on rather than lost.
+ *
+ * @param arg Simulation
+ * @return NULL
+ */
+static void *simulate(void *arg){
+  Simulation *sim;
+  struct timespec start, when;
+  double speed, paced;
+  uint64_t count;
+  int late, shown;
+  sim = (Simulation *)arg;
+  paced = SPEED_STEP;
+  count = 0;
+  shown = 1;
+  pthread_mutex_lock(&sim->lock);
+  for(;;){
+    speed = sim->speed;
+    if(sim->stop){
+      break;
+    }
+    if(speed == SPEED_STEP && sim->steps == 0){
+      /* Show the last generation before waiting for a step */
+      if(!shown){
+	pthread_mutex_unlock(&sim->lock);
+	publish(sim);
+	pthread_mutex_lock(&sim->lock);
+	shown = 1;
+	continue;
+      }
+      pthread_cond_wait(&sim->wake, &sim->lock);
+      continue;
+    }
+    if(speed > 0){
+      if(speed != paced){
+	clock_gettime(CLOCK_REALTIME, &start);
+	paced = speed;
+	count = 0;
+      }
+      when.tv_sec = start.tv_sec + (time_t)(count / speed);
+      when.tv_nsec = start.tv_nsec +
+	(long)((count / speed - (time_t)(count / speed)) * NANOSECONDS);
+      if(when.tv_nsec >= NANOSECONDS){
+	when.tv_sec++;
+	when.tv_nsec -= NANOSECONDS;
+      }
+      waitUntil(sim, &when);
+      if(sim->stop || sim->speed != speed){
+	continue;
+      }
+      count++;
+    }
+    else{
+      paced = SPEED_STEP;
+    }
+    if(speed == SPEED_STEP){
+      sim->steps--;
+    }
+    /* Flat out, only copy a generation the window will take */
+    late = speed == SPEED_MAX && sim->fresh;
+    pthread_mutex_unlock(&sim->lock);
+    sim->engine->step(sim->state);
+    if(sim->engine->changes != NULL){
+      sim->engine->changes(sim->state, sim->pending);
+    }
+    else{
+      memset(sim->pending, 1, sim->tiles);
+    }
+    if(late){
+      shown = 0;
+    }
+    else{
+      publish(sim);
+      shown = 1;
+    }
+    pthread_mutex_lock(&sim->lock);
+  }
+  pthread_mutex_unlock(&sim->lock);
+  return NULL;
+}
+/**
+ * Store the current generation into the back grid
+ * and swap it into the middle. If the window never took the grid
+ * that was there, its changes are carried into the new one.
+ *
+ * @param sim Simulation
+ */
+static void publish(Simulation *sim){
+  unsigned char *changed;
+  size_t i;
+  int temp, g;
+  for(g = 0; g < 3; g++){
+    for(i = 0; i < sim->tiles; i++){
+      sim->stale[g][i] |= sim->pending[i];
+    }
+  }
+  storeStale(sim, sim->back);
+  changed = sim->changed[sim->back];
+  memcpy(changed, sim->pending, sim->tiles);
+  memset(sim->pending, 0, sim->tiles);
+  pthread_mutex_lock(&sim->lock);
+  if(sim->fresh){
+    for(i = 0; i < sim->tiles; i++){
+      changed[i] |= sim->changed[sim->middle][i];
+    }
+  }
+  temp = sim->middle;
+  sim->middle = sim->back;
+  sim->back = temp;
+  sim->fresh = 1;
+  pthread_mutex_unlock(&sim->lock);
+}
+/**
+ * Bring a grid up to the engine's board, storing each run of stale
+ * squares along a row of squares at once, or the whole board if the
+ * engine cannot store part of it.
+ *
+ * @param sim Simulation
+ * @param g Grid
+ */
+static void storeStale(Simulation *sim, int g){
+  unsigned char *stale;
+  Grid *grid;
+  int tx, ty, end, i1, j1;
+  stale = sim->stale[g];
+  grid = sim->grid[g];
+  if(sim->engine->storeArea == NULL){
+    if(memchr(stale, 1, sim->tiles) != NULL){
+      sim->engine->store(sim->state, grid);
+    }
+  }
+  else{
+    for(ty = 0; ty < sim->tilesY; ty++){
+      j1 = (ty + 1) * CHANGE_TILE < grid->y ? (ty + 1) * CHANGE_TILE : grid->y;
+      for(tx = 0; tx < sim->tilesX; tx = end + 1){
+	for(end = tx; end < sim->tilesX && stale[ty * sim->tilesX + end]; end++);
+	if(end > tx){
+	  i1 = end * CHANGE_TILE < grid->x ? end * CHANGE_TILE : grid->x;
+	  sim->engine->storeArea(sim->state, grid, tx * CHANGE_TILE,
+				 ty * CHANGE_TILE, i1, j1);
+	}
+      }
+    }
+  }
+  memset(stale, 0, sim->tiles);
+}
+/**
+ * Wait, holding the lock, until a time has passed
+ * or the speed is changed or the simulation stopped.
+ *
+ * @param sim Simulation
+ * @param when Time to wait until
+ */
+static void waitUntil(Simulation *sim, struct timespec *when){
+  double speed;
+  speed = sim->speed;
+  while(!sim->stop && sim->speed == speed &&
+	pthread_cond_timedwait(&sim->wake, &sim->lock, when) == 0);
+}
@@ -0,0 +1,525 @@
+/**
+ * @file simd.c
+ * @author YAN SUN
+ * @version 1.0
+ *
+ * @section DESCRIPTION
+ * Vectorised Game of Life engine.
+ * Cells are stored one byte each (0 or 1), so the eight neighbours
+ * of a run of cells are summed by adding eight shifted row loads.
+ * The rule is then applied from a table of the next state of a dead
+ * and a live cell by their count, looked up with a byte shuffle.
+ * The kernel (AVX2, SSE2 or plain C) is picked by CPU detection in
+ * simdInit, all three give the same result as the scalar engine.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "life.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SIMD_X86
+#endif
+
+#define VECTOR_BYTES 32
+
+struct simd{
+  int x;
+  int y;
+  int stride;
+  int topology;
+  /* Next state of a dead cell by its count, then of a live one */
+  unsigned char table[2][16];
+  unsigned char *cells;
+  unsigned char *next;
+  /* Counts of each row in the last step, NULL when not counting */
+  RowStats *rows;
+  /* Squares each row changed, NULL when not marking */
+  uint64_t *changes;
+};
+typedef struct simd Simd;
+
+static void *simdCreate(Grid *g);
+static void *simdBlank(int x, int y);
+static void simdLive(void *state, int i, int j, int n);
+static void simdStep(void *state);
+static void simdJump(void *state, uint64_t generations);
+static void simdBand(void *state, uint64_t generation, int row0, int row1);
+static void simdStore(void *state, Grid *g);
+static void simdStoreArea(void *state, Grid *g, int i0, int j0,
+			  int i1, int j1);
+static void simdDestroy(void *state);
+static void simdChanges(void *state, unsigned char *tiles);
+static void simdStats(void *state, Stats *stats);
+static void rowScalar(unsigned char *out, const unsigned char *row,
+		      int stride, int x, const unsigned char *table,
+		      RowStats *r);
+#ifdef SIMD_X86
+static void rowSse2(unsigned char *out, const unsigned char *row,
+		    int stride, int x, const unsigned char *table,
+		    RowStats *r);
+static void rowAvx2(unsigned char *out, const unsigned char *row,
+		    int stride, int x, const unsigned char *table,
+		    RowStats *r);
+static int sumSse2(__m128i bytes);
+static int sumAvx2(__m256i bytes);
+static void finishCount(const unsigned char *out, const unsigned char *row,
+			int x, int end, int *sums, RowStats *r);
+#endif
+
+Engine simdEngine = {"simd", simdCreate, simdStep, simdStore, simdDestroy,
+		     simdJump, simdBlank, simdLive, simdChanges,
+		     simdStoreArea, simdStats, 1, 1};
+
+/* Row kernel chosen by simdInit */
+static void (*simdRow)(unsigned char *out, const unsigned char *row,
+		       int stride, int x, const unsigned char *table,
+		       RowStats *r) = rowScalar;
+
+/**
+ * Choose the row kernel.
+ * Without a name the widest instruction set the CPU supports is used.
+ *
+ * @param isa "avx2", "sse2", "scalar" or NULL to detect
+ * @return Name of the kernel in use, NULL if the CPU lacks it
+ */
+char *simdInit(char *isa){
+#ifdef SIMD_X86
+  __builtin_cpu_init();
+  if((isa == NULL || strcmp(isa, "avx2") == 0) &&
+     __builtin_cpu_supports("avx2")){
+    simdRow = rowAvx2;
+    return "avx2";
+  }
+  if((isa == NULL || strcmp(isa, "sse2") == 0) &&
+     __builtin_cpu_supports("sse2")){
+    simdRow = rowSse2;
+    return "sse2";
+  }
+#endif
+  if(isa == NULL || strcmp(isa, "scalar") == 0){
+    simdRow = rowScalar;
+    return "scalar";
+  }
+  return NULL;
+}
+/**
+ * Copy the grid into rows of bytes.
+ *
+ * @param g Grid
+ * @return The new engine state
+ */
+static void *simdCreate(Grid *g){
+  Simd *s;
+  int i, j;
+  unsigned char *row;
+  s = (Simd *)simdBlank(g->x, g->y);
+  for(j = 0; j < g->y; j++){
+    row = s->cells + (size_t)(j + 1) * s->stride + 1;
+    for(i = 0; i < g->x; i++){
+      row[i] = CELL(g, i, j) == ALIVE;
+    }
+  }
+  return s;
+}
+/**
+ * Create a byte engine with every cell dead.
+ * A row holds a ghost cell either side of the board and is padded
+ * so a vector may run past the right edge, with a ghost row above and
+ * below the board. The ghost cells are dead unless the edges wrap.
+ * The rule table and the topology are taken from the current ones,
+ * rows are counted if lifeStats is set and their changed squares
+ * marked if lifeChanges is.
+ *
+ * @param x Number of columns
+ * @param y Number of rows
+ * @return The new engine state
+ */
+static void *simdBlank(int x, int y){
+  Simd *s;
+  int k;
+  s = (Simd *)malloc(sizeof(Simd));
+  if(s == NULL){
+    printf("Cannot Allocate Engine\n");
+    exit(2);
+  }
+  s->x = x;
+  s->y = y;
+  s->stride = ((x + VECTOR_BYTES - 1) / VECTOR_BYTES + 2) * VECTOR_BYTES;
+  s->topology = lifeTopology;
+  memset(s->table, 0, sizeof(s->table));
+  for(k = 0; k <= 8; k++){
+    s->table[0][k] = (lifeRule.birth >> k) & 1;
+    s->table[1][k] = (lifeRule.survive >> k) & 1;
+  }
+  s->cells = (unsigned char *)calloc((size_t)(y + 2) * s->stride, 1);
+  s->next = (unsigned char *)calloc((size_t)(y + 2) * s->stride, 1);
+  s->rows = lifeStats ? (RowStats *)calloc(y, sizeof(RowStats)) : NULL;
+  s->changes = newChanges(x, y);
+  if(s->cells == NULL || s->next == NULL || (lifeStats && s->rows == NULL)){
+    printf("Cannot Allocate Engine\n");
+    exit(2);
+  }
+  return s;
+}
+/**
+ * Make a run of cells alive.
+ *
+ * @param state Engine state
+ * @param i First column of the run
+ * @param j Row
+ * @param n Length of the run
+ */
+static void simdLive(void *state, int i, int j, int n){
+  Simd *s;
+  s = (Simd *)state;
+  memset(s->cells + (size_t)(j + 1) * s->stride + 1 + i, 1, n);
+}
+/**
+ * Calculate the next generation.
+ *
+ * @param state Engine state
+ */
+static void simdStep(void *state){
+  simdJump(state, 1);
+}
+/**
+ * Calculate a number of generations in bands across the thread pool.
+ * The buffers take turns as source and destination, so after an odd
+ * number of generations they are swapped. The border is filled once
+ * here, the bands keep it up to date after that.
+ *
+ * @param state Engine state
+ * @param generations Number of generations
+ */
+static void simdJump(void *state, uint64_t generations){
+  Simd *s;
+  unsigned char *temp;
+  int j;
+  s = (Simd *)state;
+  for(j = 1; j <= s->y && s->topology != TOPOLOGY_DEAD; j++){
+    borderBytes(s->cells, s->x, s->y, s->stride, j, s->topology);
+  }
+  poolRun(simdBand, s, s->y, generations);
+  if(generations % 2 == 1){
+    temp = s->cells;
+    s->cells = s->next;
+    s->next = temp;
+  }
+}
+/**
+ * Calculate one generation of a band of rows.
+ *
+ * @param state Engine state
+ * @param generation Generation of the job, even ones read cells
+ * @param row0 First row of the band
+ * @param row1 Row after the band
+ */
+static void simdBand(void *state, uint64_t generation, int row0, int row1){
+  Simd *s;
+  unsigned char *from, *to;
+  int j;
+  size_t offset;
+  s = (Simd *)state;
+  from = generation % 2 == 0 ? s->cells : s->next;
+  to = generation % 2 == 0 ? s->next : s->cells;
+  for(j = row0 + 1; j <= row1; j++){
+    offset = (size_t)j * s->stride + 1;
+    simdRow(to + offset, from + offset, s->stride, s->x, s->table[0],
+	    s->rows != NULL ? &s->rows[j - 1] : NULL);
+    if(s->changes != NULL){
+      markBytes(to + offset, from + offset, s->x,
+		s->changes + (size_t)(j - 1) * changeWords(s->x));
+    }
+    /* The last vector may have written past the right edge */
+    memset(to + offset + s->x, 0, s->stride - s->x - 1);
+    /* Only this band writes the row, so it can fill the row's border */
+    borderBytes(to, s->x, s->y, s->stride, j, s->topology);
+  }
+}
+/**
+ * Calculate the next generation of one row, a cell at a time.
+ *
+ * @param out First cell of the row in the next generation
+ * @param row First cell of the row
+ * @param stride Distance between rows
+ * @param x Number of cells in the row
+ * @param table Next state of a dead cell by its count, then a live one
+ * @param r Set to the counts of the row, NULL not to count
+ */
+static void rowScalar(unsigned char *out, const unsigned char *row,
+		      int stride, int x, const unsigned char *table,
+		      RowStats *r){
+  const unsigned char *up, *down;
+  int i, sum;
+  up = row - stride;
+  down = row + stride;
+  for(i = 0; i < x; i++){
+    sum = up[i - 1] + up[i] + up[i + 1] + row[i - 1] + row[i + 1] +
+      down[i - 1] + down[i] + down[i + 1];
+    out[i] = table[row[i] * 16 + sum];
+  }
+  if(r != NULL){
+    countBytes(out, row, x, 1, r);
+  }
+}
+#ifdef SIMD_X86
+/**
+ * Finish the counts of a row from a vector kernel. The last vector
+ * ran past the row, so its lanes beyond the right edge are taken off
+ * again, and the live cells at either end are only looked for in a
+ * row that has some.
+ *
+ * @param out First cell of the row in the next generation
+ * @param row First cell of the row
+ * @param x Number of cells in the row
+ * @param end Cells the vectors covered
+ * @param sums Live cells, births and changed cells the vectors counted
+ * @param r Set to the counts of the row
+ */
+static void finishCount(const unsigned char *out, const unsigned char *row,
+			int x, int end, int *sums, RowStats *r){
+  const unsigned char *found;
+  int k;
+  for(k = x; k < end; k++){
+    sums[0] -= out[k];
+    sums[1] -= out[k] & ~row[k];
+    sums[2] -= out[k] ^ row[k];
+  }
+  r->population = sums[0];
+  r->births = sums[1];
+  r->deaths = sums[2] - sums[1];
+  r->left = r->right = -1;
+  if(r->population > 0){
+    found = (const unsigned char *)memchr(out, 1, x);
+    r->left = (int)(found - out);
+    r->right = lastCell(out, x, 1);
+  }
+}
+/**
+ * Add up the bytes of a vector.
+ *
+ * @param bytes Vector
+ * @return Sum of its bytes
+ */
+__attribute__((target("sse2")))
+static int sumSse2(__m128i bytes){
+  int64_t lanes[2];
+  _mm_storeu_si128((__m128i *)lanes, _mm_sad_epu8(bytes, _mm_setzero_si128()));
+  return (int)(lanes[0] + lanes[1]);
+}
+/**
+ * Calculate the next generation of one row, 16 cells at a time.
+ * SSE2 has no byte shuffle, so the cells are matched against each
+ * count the rule uses, at most nine compares and only two for Conway.
+ *
+ * @param out First cell of the row in the next generation
+ * @param row First cell of the row
+ * @param stride Distance between rows
+ * @param x Number of cells in the row
+ * @param table Next state of a dead cell by its count, then a live one
+ * @param r Set to the counts of the row, NULL not to count
+ */
+__attribute__((target("sse2")))
+static void rowSse2(unsigned char *out, const unsigned char *row,
+		    int stride, int x, const unsigned char *table,
+		    RowStats *r){
+  __m128i one, sum, live, next, count[9], born[9], kept[9];
+  __m128i alive, population, births, changed;
+  const unsigned char *p;
+  int i, k, terms, block, sums[3];
+  one = _mm_set1_epi8(1);
+  population = births = changed = _mm_setzero_si128();
+  sums[0] = sums[1] = sums[2] = 0;
+  block = 0;
+  terms = 0;
+  for(k = 0; k <= 8; k++){
+    if(table[k] | table[16 + k]){
+      count[terms] = _mm_set1_epi8((char)k);
+      born[terms] = _mm_set1_epi8(table[k] ? -1 : 0);
+      kept[terms] = _mm_set1_epi8(table[16 + k] ? -1 : 0);
+      terms++;
+    }
+  }
+  for(i = 0; i < x; i += 16){
+    p = row + i;
+    sum = _mm_add_epi8(_mm_loadu_si128((const __m128i *)(p - stride - 1)),
+		       _mm_loadu_si128((const __m128i *)(p - stride)));
+    sum = _mm_add_epi8(sum, _mm_loadu_si128((const __m128i *)(p - stride + 1)));
+    sum = _mm_add_epi8(sum, _mm_loadu_si128((const __m128i *)(p - 1)));
+    sum = _mm_add_epi8(sum, _mm_loadu_si128((const __m128i *)(p + 1)));
+    sum = _mm_add_epi8(sum, _mm_loadu_si128((const __m128i *)(p + stride - 1)));
+    sum = _mm_add_epi8(sum, _mm_loadu_si128((const __m128i *)(p + stride)));
+    sum = _mm_add_epi8(sum, _mm_loadu_si128((const __m128i *)(p + stride + 1)));
+    live = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)p), one);
+    next = _mm_setzero_si128();
+    for(k = 0; k < terms; k++){
+      next = _mm_or_si128(next, _mm_and_si128(_mm_cmpeq_epi8(sum, count[k]),
+			  _mm_or_si128(_mm_and_si128(live, kept[k]),
+				       _mm_andnot_si128(live, born[k]))));
+    }
+    next = _mm_and_si128(next, one);
+    _mm_storeu_si128((__m128i *)(out + i), next);
+    if(r != NULL){
+      alive = _mm_and_si128(live, one);
+      population = _mm_add_epi8(population, next);
+      births = _mm_add_epi8(births, _mm_andnot_si128(alive, next));
+      changed = _mm_add_epi8(changed, _mm_xor_si128(alive, next));
+      if(++block == COUNT_BLOCK || i + 16 >= x){
+	sums[0] += sumSse2(population);
+	sums[1] += sumSse2(births);
+	sums[2] += sumSse2(changed);
+	population = births = changed = _mm_setzero_si128();
+	block = 0;
+      }
+    }
+  }
+  if(r != NULL){
+    finishCount(out, row, x, i, sums, r);
+  }
+}
+/**
+ * Add up the bytes of a vector.
+ *
+ * @param bytes Vector
+ * @return Sum of its bytes
+ */
+__attribute__((target("avx2")))
+static int sumAvx2(__m256i bytes){
+  int64_t lanes[4];
+  _mm256_storeu_si256((__m256i *)lanes, _mm256_sad_epu8(bytes, _mm256_setzero_si256()));
+  return (int)(lanes[0] + lanes[1] + lanes[2] + lanes[3]);
+}
+/**
+ * Calculate the next generation of one row, 32 cells at a time.
+ * The count picks the next state out of both tables with a byte
+ * shuffle, then the cell picks between them with a blend.
+ *
+ * @param out First cell of the row in the next generation
+ * @param row First cell of the row
+ * @param stride Distance between rows
+ * @param x Number of cells in the row
+ * @param table Next state of a dead cell by its count, then a live one
+ * @param r Set to the counts of the row, NULL not to count
+ */
+__attribute__((target("avx2")))
+static void rowAvx2(unsigned char *out, const unsigned char *row,
+		    int stride, int x, const unsigned char *table,
+		    RowStats *r){
+  __m256i one, dead, live, sum, alive, born, kept, next;
+  __m256i population, births, changed;
+  const unsigned char *p;
+  int i, block, sums[3];
+  one = _mm256_set1_epi8(1);
+  population = births = changed = _mm256_setzero_si256();
+  sums[0] = sums[1] = sums[2] = 0;
+  block = 0;
+  /* The shuffle works within each 128-bit lane, so both get a copy */
+  dead = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)table));
+  live = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)(table + 16)));
+  for(i = 0; i < x; i += 32){
+    p = row + i;
+    sum = _mm256_add_epi8(_mm256_loadu_si256((const __m256i *)(p - stride - 1)),
+			  _mm256_loadu_si256((const __m256i *)(p - stride)));
+    sum = _mm256_add_epi8(sum, _mm256_loadu_si256((const __m256i *)(p - stride + 1)));
+    sum = _mm256_add_epi8(sum, _mm256_loadu_si256((const __m256i *)(p - 1)));
+    sum = _mm256_add_epi8(sum, _mm256_loadu_si256((const __m256i *)(p + 1)));
+    sum = _mm256_add_epi8(sum, _mm256_loadu_si256((const __m256i *)(p + stride - 1)));
+    sum = _mm256_add_epi8(sum, _mm256_loadu_si256((const __m256i *)(p + stride)));
+    sum = _mm256_add_epi8(sum, _mm256_loadu_si256((const __m256i *)(p + stride + 1)));
+    alive = _mm256_loadu_si256((const __m256i *)p);
+    born = _mm256_shuffle_epi8(dead, sum);
+    kept = _mm256_shuffle_epi8(live, sum);
+    next = _mm256_blendv_epi8(born, kept, _mm256_cmpeq_epi8(alive, one));
+    _mm256_storeu_si256((__m256i *)(out + i), next);
+    /* The counts come from the vectors already in registers, kept in
+       bytes and only widened once a byte could overflow */
+    if(r != NULL){
+      population = _mm256_add_epi8(population, next);
+      births = _mm256_add_epi8(births, _mm256_andnot_si256(alive, next));
+      changed = _mm256_add_epi8(changed, _mm256_xor_si256(alive, next));
+      if(++block == COUNT_BLOCK || i + 32 >= x){
+	sums[0] += sumAvx2(population);
+	sums[1] += sumAvx2(births);
+	sums[2] += sumAvx2(changed);
+	population = births = changed = _mm256_setzero_si256();
+	block = 0;
+      }
+    }
+  }
+  if(r != NULL){
+    finishCount(out, row, x, i, sums, r);
+  }
+}
+#endif
+/**
+ * Copy the current generation into the grid.
+ *
+ * @param state Engine state
+ * @param g Grid
+ */
+static void simdStore(void *state, Grid *g){
+  Simd *s;
+  s = (Simd *)state;
+  simdStoreArea(state, g, 0, 0, s->x, s->y);
+}
+/**
+ * Copy part of the current generation into the grid.
+ *
+ * @param state Engine state
+ * @param g Grid
+ * @param i0 First column
+ * @param j0 First row
+ * @param i1 Column after the area
+ * @param j1 Row after the area
+ */
+static void simdStoreArea(void *state, Grid *g, int i0, int j0,
+			  int i1, int j1){
+  Simd *s;
+  int i, j;
+  unsigned char *row;
+  s = (Simd *)state;
+  for(j = j0; j < j1; j++){
+    row = s->cells + (size_t)(j + 1) * s->stride + 1;
+    for(i = i0; i < i1; i++){
+      CELL(g, i, j) = row[i] ? ALIVE : DEAD;
+    }
+  }
+}
+/**
+ * Set the squares changed since they were last asked for.
+ *
+ * @param state Engine state
+ * @param tiles Squares, set to 1 where cells changed
+ */
+static void simdChanges(void *state, unsigned char *tiles){
+  Simd *s;
+  s = (Simd *)state;
+  sumChanges(s->changes, s->x, s->y, tiles);
+}
+/**
+ * Sum the counts of the rows from the last step.
+ *
+ * @param state Engine state
+ * @param stats Set to the statistics
+ */
+static void simdStats(void *state, Stats *stats){
+  Simd *s;
+  s = (Simd *)state;
+  sumRows(s->rows, s->y, stats);
+}
+/**
+ * Free the engine state.
+ *
+ * @param state Engine state
+ */
+static void simdDestroy(void *state){
+  Simd *s;
+  s = (Simd *)state;
+  free(s->cells);
+  free(s->next);
+  free(s->rows);
+  free(s->changes);
+  free(s);
+}
@@ -0,0 +1,624 @@
+/**
+ * @file sparse.c
+ * @author YAN SUN
+ * @version 1.0
+ *
+ * @section DESCRIPTION
+ * Sparse Game of Life engine for mostly empty universes.
+ * The plane is cut into 64x64 tiles of bit-packed rows, kept in a
+ * hash table by tile position. Only the tiles that changed in the
+ * last generation and their neighbours are stepped: a tile whose
+ * neighbourhood did not change cannot change either. Empty tiles
+ * are freed, so the work and memory follow the live cells.
+ *
+ * The "sparse" engine is bounded by the loaded board like the other
+ * engines. The "plane" engine has no edge at all, patterns can grow
+ * anywhere and store copies out the window of the loaded board.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "life.h"
+#include "swar.h"
+
+#define TILE_SIZE 64
+#define FIRST_BUCKETS 1024
+
+struct tile{
+  int tx;
+  int ty;
+  int changed;
+  int queued;
+  uint64_t cells[TILE_SIZE];
+  uint64_t next[TILE_SIZE];
+  struct tile *chain;
+};
+typedef struct tile Tile;
+
+/* A growable list of tiles */
+struct tiles{
+  Tile **tile;
+  int count;
+  int size;
+};
+typedef struct tiles Tiles;
+
+struct sparse{
+  int x;
+  int y;
+  int bounded;
+  RuleTerms terms;
+  Tile **table;
+  int buckets;
+  int count;
+  Tiles active;
+  Tiles work;
+  /* Squares of the board changed since last asked, NULL when not
+     marking */
+  unsigned char *marked;
+  int tilesX;
+  int tilesY;
+};
+typedef struct sparse Sparse;
+
+static void *sparseCreate(Grid *g);
+static void *planeCreate(Grid *g);
+static void *createTiles(Grid *g, int bounded);
+static void *sparseBlank(int x, int y);
+static void *planeBlank(int x, int y);
+static void *newTiles(int x, int y, int bounded);
+static void sparseLive(void *state, int i, int j, int n);
+static void sparseStep(void *state);
+static void sparseStore(void *state, Grid *g);
+static void sparseStoreArea(void *state, Grid *g, int i0, int j0,
+			    int i1, int j1);
+static void sparseDestroy(void *state);
+static void sparseChanges(void *state, unsigned char *tiles);
+static Tile *findTile(Sparse *s, int tx, int ty);
+static Tile *addTile(Sparse *s, int tx, int ty);
+static void removeTile(Sparse *s, Tile *t);
+static void growTable(Sparse *s);
+static void pushTile(Tiles *list, Tile *t);
+static void queueTile(Sparse *s, int tx, int ty);
+static void queueNeighbours(Sparse *s, Tile *t);
+static void stepTile(Sparse *s, Tile *t);
+static void clipTile(Sparse *s, Tile *t);
+static int bucket(Sparse *s, int tx, int ty);
+
+Engine sparseEngine = {"sparse", sparseCreate, sparseStep,
+		       sparseStore, sparseDestroy, NULL,
+		       sparseBlank, sparseLive, sparseChanges,
+		       sparseStoreArea, NULL, 1, 0};
+Engine planeEngine = {"plane", planeCreate, sparseStep,
+		      sparseStore, sparseDestroy, NULL,
+		      planeBlank, sparseLive, sparseChanges,
+		      sparseStoreArea, NULL, 0, 0};
+
+/**
+ * Create a sparse engine bounded by the board.
+ *
+ * @param g Grid
+ * @return The new engine state
+ */
+static void *sparseCreate(Grid *g){
+  return createTiles(g, 1);
+}
+/**
+ * Create a sparse engine on an unbounded plane.
+ *
+ * @param g Grid
+ * @return The new engine state
+ */
+static void *planeCreate(Grid *g){
+  return createTiles(g, 0);
+}
+/**
+ * Copy the live cells of the grid into tiles.
+ *
+ * @param g Grid
+ * @param bounded 1 to keep the cells inside the board
+ * @return The new engine state
+ */
+static void *createTiles(Grid *g, int bounded){
+  Sparse *s;
+  int i, j;
+  s = (Sparse *)newTiles(g->x, g->y, bounded);
+  for(j = 0; j < g->y; j++){
+    for(i = 0; i < g->x; i++){
+      if(CELL(g, i, j) == ALIVE){
+	sparseLive(s, i, j, 1);
+      }
+    }
+  }
+  return s;
+}
+/**
+ * Create a bounded sparse engine with no live cells.
+ *
+ * @param x Number of columns
+ * @param y Number of rows
+ * @return The new engine state
+ */
+static void *sparseBlank(int x, int y){
+  return newTiles(x, y, 1);
+}
+/**
+ * Create an unbounded sparse engine with no live cells.
+ *
+ * @param x Number of columns of the window
+ * @param y Number of rows of the window
+ * @return The new engine state
+ */
+static void *planeBlank(int x, int y){
+  return newTiles(x, y, 0);
+}
+/**
+ * Create an engine state with no tiles.
+ *
+ * @param x Number of columns
+ * @param y Number of rows
+ * @param bounded 1 to keep the cells inside the board
+ * @return The new engine state
+ */
+static void *newTiles(int x, int y, int bounded){
+  Sparse *s;
+  s = (Sparse *)calloc(1, sizeof(Sparse));
+  if(s == NULL){
+    printf("Cannot Allocate Engine\n");
+    exit(2);
+  }
+  s->x = x;
+  s->y = y;
+  s->bounded = bounded;
+  s->tilesX = (x + TILE_SIZE - 1) / TILE_SIZE;
+  s->tilesY = (y + TILE_SIZE - 1) / TILE_SIZE;
+  if(lifeChanges){
+    s->marked = (unsigned char *)calloc((size_t)s->tilesX * s->tilesY, 1);
+    if(s->marked == NULL){
+      printf("Cannot Allocate Engine\n");
+      exit(2);
+    }
+  }
+  compileTerms(&lifeRule, &s->terms);
+  s->buckets = FIRST_BUCKETS;
+  s->table = (Tile **)calloc(s->buckets, sizeof(Tile *));
+  if(s->table == NULL){
+    printf("Cannot Allocate Engine\n");
+    exit(2);
+  }
+  return s;
+}
+/**
+ * Make a run of cells alive, creating the tiles it crosses.
+ * A new tile starts out changed so it is stepped at least once.
+ *
+ * @param state Engine state
+ * @param i First column of the run
+ * @param j Row
+ * @param n Length of the run
+ */
+static void sparseLive(void *state, int i, int j, int n){
+  Sparse *s;
+  Tile *t;
+  int bit, take;
+  s = (Sparse *)state;
+  while(n > 0){
+    t = findTile(s, i / TILE_SIZE, j / TILE_SIZE);
+    if(t == NULL){
+      t = addTile(s, i / TILE_SIZE, j / TILE_SIZE);
+      t->changed = 1;
+      pushTile(&s->active, t);
+    }
+    bit = i % TILE_SIZE;
+    take = TILE_SIZE - bit < n ? TILE_SIZE - bit : n;
+    t->cells[j % TILE_SIZE] |= (take == TILE_SIZE ? ~0ULL : (1ULL << take) - 1) << bit;
+    i += take;
+    n -= take;
+  }
+}
+/**
+ * Advance one generation.
+ * The tiles that changed last time and their neighbours are queued,
+ * all of them are stepped into their next buffers, then the new
+ * cells are committed, and the changed ones on the board marked if
+ * lifeChanges was set. Tiles that are empty and did not change are
+ * freed.
+ *
+ * @param state Engine state
+ */
+static void sparseStep(void *state){
+  Sparse *s;
+  Tile *t;
+  int n, r, empty;
+  s = (Sparse *)state;
+  s->work.count = 0;
+  for(n = 0; n < s->active.count; n++){
+    t = s->active.tile[n];
+    queueTile(s, t->tx, t->ty);
+    queueNeighbours(s, t);
+  }
+  for(n = 0; n < s->work.count; n++){
+    stepTile(s, s->work.tile[n]);
+  }
+  /* Every tile has read its neighbours, so the new cells can go in */
+  s->active.count = 0;
+  for(n = 0; n < s->work.count; n++){
+    t = s->work.tile[n];
+    t->queued = 0;
+    t->changed = memcmp(t->cells, t->next, sizeof(t->cells)) != 0;
+    if(t->changed){
+      memcpy(t->cells, t->next, sizeof(t->cells));
+      pushTile(&s->active, t);
+      if(s->marked != NULL && t->tx >= 0 && t->tx < s->tilesX &&
+	 t->ty >= 0 && t->ty < s->tilesY){
+	s->marked[t->ty * s->tilesX + t->tx] = 1;
+      }
+    }
+    else{
+      empty = 1;
+      for(r = 0; r < TILE_SIZE && empty; r++){
+	empty = t->cells[r] == 0;
+      }
+      if(empty){
+	removeTile(s, t);
+      }
+    }
+  }
+}
+/**
+ * Queue the neighbours of a changed tile.
+ * Neighbours that exist are always queued. A missing neighbour is
+ * only created when the tile has live cells on the edge facing it,
+ * otherwise nothing can be born there.
+ *
+ * @param s Engine state
+ * @param t Changed tile
+ */
+static void queueNeighbours(Sparse *s, Tile *t){
+  uint64_t west, east;
+  int r, dx, dy, live;
+  west = east = 0;
+  for(r = 0; r < TILE_SIZE; r++){
+    west |= t->cells[r] & 1;
+    east |= t->cells[r] >> 63;
+  }
+  for(dy = -1; dy <= 1; dy++){
+    for(dx = -1; dx <= 1; dx++){
+      if(dx == 0 && dy == 0){
+	continue;
+      }
+      /* Live cells on the facing edge or corner */
+      if(dy == 0){
+	live = dx < 0 ? west != 0 : east != 0;
+      }
+      else{
+	r = dy < 0 ? 0 : TILE_SIZE - 1;
+	if(dx < 0){
+	  live = (t->cells[r] & 1) != 0;
+	}
+	else if(dx > 0){
+	  live = (t->cells[r] >> 63) != 0;
+	}
+	else{
+	  live = t->cells[r] != 0;
+	}
+      }
+      if(live || findTile(s, t->tx + dx, t->ty + dy) != NULL){
+	queueTile(s, t->tx + dx, t->ty + dy);
+      }
+    }
+  }
+}
+/**
+ * Queue a tile for this generation, creating it if needed.
+ * A bounded engine never creates tiles outside the board.
+ *
+ * @param s Engine state
+ * @param tx Tile column
+ * @param ty Tile row
+ */
+static void queueTile(Sparse *s, int tx, int ty){
+  Tile *t;
+  if(s->bounded &&
+     (tx < 0 || ty < 0 ||
+      (long)tx * TILE_SIZE >= s->x || (long)ty * TILE_SIZE >= s->y)){
+    return;
+  }
+  t = findTile(s, tx, ty);
+  if(t == NULL){
+    t = addTile(s, tx, ty);
+  }
+  if(!t->queued){
+    t->queued = 1;
+    pushTile(&s->work, t);
+  }
+}
+/**
+ * Calculate the next generation of a tile into its next buffer.
+ * Rows above and below and the bits either side come from the
+ * neighbouring tiles, a missing tile reads as dead.
+ *
+ * @param s Engine state
+ * @param t Tile
+ */
+static void stepTile(Sparse *s, Tile *t){
+  Tile *near[9];
+  uint64_t w[TILE_SIZE + 2], c[TILE_SIZE + 2], e[TILE_SIZE + 2];
+  int r, dx, dy;
+  for(dy = -1; dy <= 1; dy++){
+    for(dx = -1; dx <= 1; dx++){
+      near[(dy + 1) * 3 + dx + 1] = dx == 0 && dy == 0 ? t :
+	findTile(s, t->tx + dx, t->ty + dy);
+    }
+  }
+  /* Gather rows -1 to 64 of this column of tiles and the two beside */
+  for(r = -1; r <= TILE_SIZE; r++){
+    dy = r < 0 ? 0 : r < TILE_SIZE ? 1 : 2;
+    w[r + 1] = near[dy * 3] ? near[dy * 3]->cells[(r + TILE_SIZE) % TILE_SIZE] : 0;
+    c[r + 1] = near[dy * 3 + 1] ? near[dy * 3 + 1]->cells[(r + TILE_SIZE) % TILE_SIZE] : 0;
+    e[r + 1] = near[dy * 3 + 2] ? near[dy * 3 + 2]->cells[(r + TILE_SIZE) % TILE_SIZE] : 0;
+  }
+  if(s->terms.conway){
+    for(r = 1; r <= TILE_SIZE; r++){
+      t->next[r - 1] = swarWord(NULL, w[r - 1], c[r - 1], e[r - 1],
+				w[r], c[r], e[r],
+				w[r + 1], c[r + 1], e[r + 1]);
+    }
+  }
+  else{
+    for(r = 1; r <= TILE_SIZE; r++){
+      t->next[r - 1] = swarWord(&s->terms, w[r - 1], c[r - 1], e[r - 1],
+				w[r], c[r], e[r],
+				w[r + 1], c[r + 1], e[r + 1]);
+    }
+  }
+  if(s->bounded){
+    clipTile(s, t);
+  }
+}
+/**
+ * Clear the cells of the next generation that lie off the board.
+ *
+ * @param s Engine state
+ * @param t Tile
+ */
+static void clipTile(Sparse *s, Tile *t){
+  uint64_t mask;
+  int r, right, bottom;
+  right = (t->tx + 1) * TILE_SIZE - s->x;
+  bottom = (t->ty + 1) * TILE_SIZE - s->y;
+  if(right > 0){
+    mask = ~0ULL >> right;
+    for(r = 0; r < TILE_SIZE; r++){
+      t->next[r] &= mask;
+    }
+  }
+  for(r = TILE_SIZE - bottom; r < TILE_SIZE; r++){
+    t->next[r] = 0;
+  }
+}
+/**
+ * Copy the window of the loaded board out of the tiles.
+ *
+ * @param state Engine state
+ * @param g Grid
+ */
+static void sparseStore(void *state, Grid *g){
+  Sparse *s;
+  Tile *t;
+  long x, y;
+  int b, i, r;
+  s = (Sparse *)state;
+  memset(g->cells, DEAD, (size_t)g->x * g->y);
+  for(b = 0; b < s->buckets; b++){
+    for(t = s->table[b]; t != NULL; t = t->chain){
+      for(r = 0; r < TILE_SIZE; r++){
+	y = (long)t->ty * TILE_SIZE + r;
+	if(t->cells[r] == 0 || y < 0 || y >= g->y){
+	  continue;
+	}
+	for(i = 0; i < TILE_SIZE; i++){
+	  x = (long)t->tx * TILE_SIZE + i;
+	  if((t->cells[r] >> i) & 1 && x >= 0 && x < g->x){
+	    CELL(g, x, y) = ALIVE;
+	  }
+	}
+      }
+    }
+  }
+}
+/**
+ * Copy part of the loaded board out of the tiles it covers.
+ *
+ * @param state Engine state
+ * @param g Grid
+ * @param i0 First column
+ * @param j0 First row
+ * @param i1 Column after the area
+ * @param j1 Row after the area
+ */
+static void sparseStoreArea(void *state, Grid *g, int i0, int j0,
+			    int i1, int j1){
+  Sparse *s;
+  Tile *t;
+  uint64_t cells;
+  int i, j;
+  s = (Sparse *)state;
+  cells = 0;
+  for(j = j0; j < j1; j++){
+    for(i = i0; i < i1; i++){
+      if(i == i0 || i % TILE_SIZE == 0){
+	t = findTile(s, i / TILE_SIZE, j / TILE_SIZE);
+	cells = t != NULL ? t->cells[j % TILE_SIZE] : 0;
+      }
+      CELL(g, i, j) = (cells >> (i % TILE_SIZE)) & 1 ? ALIVE : DEAD;
+    }
+  }
+}
+/**
+ * Set the squares changed since they were last asked for. The tiles
+ * are the squares, so when marking they are copied straight over,
+ * otherwise the active list holds the ones the last step changed and
+ * this costs only as much as the change. Tiles off the board are left
+ * out.
+ *
+ * @param state Engine state
+ * @param tiles Squares, set to 1 where cells changed
+ */
+static void sparseChanges(void *state, unsigned char *tiles){
+  Sparse *s;
+  Tile *t;
+  size_t k;
+  int n;
+  s = (Sparse *)state;
+  if(s->marked != NULL){
+    for(k = 0; k < (size_t)s->tilesX * s->tilesY; k++){
+      tiles[k] |= s->marked[k];
+    }
+    memset(s->marked, 0, (size_t)s->tilesX * s->tilesY);
+    return;
+  }
+  for(n = 0; n < s->active.count; n++){
+    t = s->active.tile[n];
+    if(t->tx >= 0 && t->tx < s->tilesX && t->ty >= 0 && t->ty < s->tilesY){
+      tiles[t->ty * s->tilesX + t->tx] = 1;
+    }
+  }
+}
+/**
+ * Free the engine state and every tile.
+ *
+ * @param state Engine state
+ */
+static void sparseDestroy(void *state){
+  Sparse *s;
+  Tile *t, *chain;
+  int b;
+  s = (Sparse *)state;
+  for(b = 0; b < s->buckets; b++){
+    for(t = s->table[b]; t != NULL; t = chain){
+      chain = t->chain;
+      free(t);
+    }
+  }
+  free(s->table);
+  free(s->active.tile);
+  free(s->work.tile);
+  free(s->marked);
+  free(s);
+}
+/**
+ * Hash a tile position into a bucket.
+ *
+ * @param s Engine state
+ * @param tx Tile column
+ * @param ty Tile row
+ * @return Bucket number
+ */
+static int bucket(Sparse *s, int tx, int ty){
+  uint32_t h;
+  h = (uint32_t)tx * 0x9E3779B1u ^ (uint32_t)ty * 0x85EBCA77u;
+  h ^= h >> 15;
+  return h & (s->buckets - 1);
+}
+/**
+ * Find a tile by position.
+ *
+ * @param s Engine state
+ * @param tx Tile column
+ * @param ty Tile row
+ * @return The tile, NULL if it does not exist
+ */
+static Tile *findTile(Sparse *s, int tx, int ty){
+  Tile *t;
+  for(t = s->table[bucket(s, tx, ty)]; t != NULL; t = t->chain){
+    if(t->tx == tx && t->ty == ty){
+      return t;
+    }
+  }
+  return NULL;
+}
+/**
+ * Add an empty tile to the table.
+ *
+ * @param s Engine state
+ * @param tx Tile column
+ * @param ty Tile row
+ * @return The new tile
+ */
+static Tile *addTile(Sparse *s, int tx, int ty){
+  Tile *t;
+  int b;
+  if(s->count >= s->buckets){
+    growTable(s);
+  }
+  t = (Tile *)calloc(1, sizeof(Tile));
+  if(t == NULL){
+    printf("Cannot Allocate Tile\n");
+    exit(2);
+  }
+  t->tx = tx;
+  t->ty = ty;
+  b = bucket(s, tx, ty);
+  t->chain = s->table[b];
+  s->table[b] = t;
+  s->count++;
+  return t;
+}
+/**
+ * Unlink a tile from the table and free it.
+ *
+ * @param s Engine state
+ * @param t Tile
+ */
+static void removeTile(Sparse *s, Tile *t){
+  Tile **link;
+  for(link = &s->table[bucket(s, t->tx, t->ty)]; *link != t;
+      link = &(*link)->chain);
+  *link = t->chain;
+  s->count--;
+  free(t);
+}
+/**
+ * Double the number of buckets and rehash every tile.
+ *
+ * @param s Engine state
+ */
+static void growTable(Sparse *s){
+  Tile **old, *t, *chain;
+  int b, size;
+  old = s->table;
+  size = s->buckets;
+  s->buckets *= 2;
+  s->table = (Tile **)calloc(s->buckets, sizeof(Tile *));
+  if(s->table == NULL){
+    printf("Cannot Allocate Engine\n");
+    exit(2);
+  }
+  for(b = 0; b < size; b++){
+    for(t = old[b]; t != NULL; t = chain){
+      chain = t->chain;
+      t->chain = s->table[bucket(s, t->tx, t->ty)];
+      s->table[bucket(s, t->tx, t->ty)] = t;
+    }
+  }
+  free(old);
+}
+/**
+ * Append a tile to a list, growing it as needed.
+ *
+ * @param list List
+ * @param t Tile
+ */
+static void pushTile(Tiles *list, Tile *t){
+  if(list->count == list->size){
+    list->size = list->size ? list->size * 2 : 64;
+    list->tile = (Tile **)realloc(list->tile, list->size * sizeof(Tile *));
+    if(list->tile == NULL){
+      printf("Cannot Allocate Engine\n");
+      exit(2);
+    }
+  }
+  list->tile[list->count++] = t;
+}
@@ -0,0 +1,181 @@
+/**
+ * @file stats.c
+ * @author YAN SUN
+ * @version 1.0
+ *
+ * @section DESCRIPTION
+ * Population statistics counted while stepping.
+ * An engine created while lifeStats is set keeps a count for every
+ * row: its live cells, births, deaths and first and last live column.
+ * The row is counted by the thread that wrote it, straight after it
+ * is written and still in the cache, so nothing is shared between the
+ * bands and the board is never scanned again. The rows are summed
+ * into the board's statistics only when they are asked for.
+ * Statistics are written one record per generation, as CSV or as
+ * eight 64-bit integers in the machine's byte order: generation,
+ * population, births, deaths and the left, top, right and bottom of
+ * the live cells, -1 when there are none.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "life.h"
+
+#define STATS_BUFFER (1 << 20)
+#define STATS_FIELDS 8
+#define BYTES_ONE 0x0101010101010101ULL
+#define BYTES_TOP 0x8080808080808080ULL
+
+/* Count statistics in the engines created from now on */
+int lifeStats = 0;
+
+/**
+ * Count one row of a board of bytes against the row before it.
+ * The cells are counted in blocks small enough for byte counters,
+ * which the compiler turns into vector adds, and the live cells at
+ * either end are only looked for in the first and last live blocks.
+ *
+ * @param now Row in the new generation
+ * @param before Row in the generation before
+ * @param x Number of columns
+ * @param alive Value of a live cell
+ * @param r Set to the counts of the row
+ */
+void countBytes(const unsigned char *now, const unsigned char *before,
+		int x, unsigned char alive, RowStats *r){
+  const unsigned char *first;
+  unsigned char n, c, p, b, d;
+  int i, k, end, left, right;
+  r->population = r->births = r->deaths = 0;
+  left = right = -1;
+  for(i = 0; i < x; i = end){
+    end = x - i < COUNT_BLOCK ? x : i + COUNT_BLOCK;
+    p = b = d = 0;
+    for(k = i; k < end; k++){
+      n = now[k] == alive;
+      c = before[k] == alive;
+      p += n;
+      b += n & ~c & 1;
+      d += c & ~n & 1;
+    }
+    r->population += p;
+    r->births += b;
+    r->deaths += d;
+    if(p > 0){
+      left = left < 0 ? i : left;
+      right = end;
+    }
+  }
+  r->left = r->right = -1;
+  if(left >= 0){
+    first = (const unsigned char *)memchr(now + left, alive, x - left);
+    r->left = (int)(first - now);
+    r->right = lastCell(now, right, alive);
+  }
+}
+/**
+ * Find the last cell of a row with a value. The cells are tested eight
+ * at a time, so the dead run at the end of a row is crossed quickly.
+ *
+ * @param cells Row
+ * @param n Number of cells
+ * @param value Value looked for
+ * @return Column of the last cell with the value, -1 if there is none
+ */
+int lastCell(const unsigned char *cells, int n, unsigned char value){
+  uint64_t word;
+  int k;
+  for(k = n; k >= 8; k -= 8){
+    memcpy(&word, cells + k - 8, 8);
+    /* A byte of the value becomes zero, and any zero byte sets a top bit */
+    word ^= BYTES_ONE * value;
+    if((word - BYTES_ONE) & ~word & BYTES_TOP){
+      break;
+    }
+  }
+  for(k--; k >= 0 && cells[k] != value; k--);
+  return k;
+}
+/**
+ * Sum the counts of the rows into the board's statistics.
+ *
+ * @param rows Counts of each row, NULL if the engine kept none
+ * @param y Number of rows
+ * @param stats Set to the statistics
+ */
+void sumRows(const RowStats *rows, int y, Stats *stats){
+  int j;
+  memset(stats, 0, sizeof(Stats));
+  stats->left = stats->top = stats->right = stats->bottom = -1;
+  for(j = 0; rows != NULL && j < y; j++){
+    stats->births += rows[j].births;
+    stats->deaths += rows[j].deaths;
+    if(rows[j].population == 0){
+      continue;
+    }
+    stats->population += rows[j].population;
+    if(stats->top < 0){
+      stats->top = j;
+      stats->left = rows[j].left;
+    }
+    stats->bottom = j;
+    if(rows[j].left < stats->left){
+      stats->left = rows[j].left;
+    }
+    if(rows[j].right > stats->right){
+      stats->right = rows[j].right;
+    }
+  }
+}
+/**
+ * Open a file for statistics, with a header line for CSV.
+ *
+ * @param name File name
+ * @param binary 1 for binary records, 0 for CSV
+ * @return The file, NULL if it cannot be written
+ */
+FILE *openStats(char *name, int binary){
+  FILE *file;
+  file = fopen(name, binary ? "wb" : "w");
+  if(file == NULL){
+    printf("Could not write statistics (%s). \n", name);
+    return NULL;
+  }
+  /* Millions of small records, so they go out in large writes */
+  setvbuf(file, NULL, _IOFBF, STATS_BUFFER);
+  if(!binary){
+    fprintf(file, "generation,population,births,deaths,"
+	    "left,top,right,bottom\n");
+  }
+  return file;
+}
+/**
+ * Write one generation's statistics.
+ *
+ * @param file File
+ * @param binary 1 for a binary record, 0 for a CSV line
+ * @param generation Generation
+ * @param stats Statistics
+ */
+void writeStats(FILE *file, int binary, uint64_t generation, Stats *stats){
+  int64_t record[STATS_FIELDS];
+  if(binary){
+    record[0] = (int64_t)generation;
+    record[1] = (int64_t)stats->population;
+    record[2] = (int64_t)stats->births;
+    record[3] = (int64_t)stats->deaths;
+    record[4] = stats->left;
+    record[5] = stats->top;
+    record[6] = stats->right;
+    record[7] = stats->bottom;
+    fwrite(record, sizeof(int64_t), STATS_FIELDS, file);
+  }
+  else{
+    fprintf(file, "%llu,%llu,%llu,%llu,%d,%d,%d,%d\n",
+	    (unsigned long long)generation,
+	    (unsigned long long)stats->population,
+	    (unsigned long long)stats->births,
+	    (unsigned long long)stats->deaths,
+	    stats->left, stats->top, stats->right, stats->bottom);
+  }
+}
@@ -0,0 +1,482 @@
+/**
+ * @file swar.c
+ * @author YAN SUN
+ * @version 1.0
+ *
+ * @section DESCRIPTION
+ * Bit-packed Game of Life engine.
+ * Each row is stored as 64 cells per uint64_t. The eight neighbours
+ * of a whole word are added with bit-sliced adders (SWAR), so a
+ * handful of logic instructions advances 64 cells at once.
+ * Every row has a guard word on each side and there is a guard row
+ * above and below, zero so cells outside the board are dead, or
+ * holding the cells across the edge when the edges wrap.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include "life.h"
+#include "swar.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define SWAR_X86
+#endif
+
+#define WORD_BITS 64
+/* A byte of cells spread one to a byte, see spreadByte */
+#define SPREAD_MULTIPLIER 0x0101010101010101ULL
+#define SPREAD_BITS 0x8040201008040201ULL
+#define SPREAD_CARRY 0x7F7F7F7F7F7F7F7FULL
+#define SPREAD_TOP 0x8080808080808080ULL
+
+struct swar{
+  int x;
+  int y;
+  int words;
+  int stride;
+  uint64_t lastMask;
+  int topology;
+  RuleTerms terms;
+  uint64_t *cells;
+  uint64_t *next;
+  /* Counts of each row in the last step, NULL when not counting */
+  RowStats *rows;
+  void (*count)(const uint64_t *now, const uint64_t *before, int words,
+		uint64_t lastMask, RowStats *r);
+  /* Squares each row changed, NULL when not marking */
+  uint64_t *changes;
+};
+typedef struct swar Swar;
+
+static void *swarCreate(Grid *g);
+static void *swarBlank(int x, int y);
+static void swarLive(void *state, int i, int j, int n);
+static void swarStep(void *state);
+static void swarJump(void *state, uint64_t generations);
+static void swarBand(void *state, uint64_t generation, int row0, int row1);
+static void swarStore(void *state, Grid *g);
+static void swarStoreArea(void *state, Grid *g, int i0, int j0,
+			  int i1, int j1);
+static uint64_t spreadByte(uint64_t bits);
+static void swarDestroy(void *state);
+static void swarChanges(void *state, unsigned char *tiles);
+static void swarStats(void *state, Stats *stats);
+static void countPlain(const uint64_t *now, const uint64_t *before,
+		       int words, uint64_t lastMask, RowStats *r);
+#ifdef SWAR_X86
+static void countPopcnt(const uint64_t *now, const uint64_t *before,
+			int words, uint64_t lastMask, RowStats *r);
+#endif
+static void swarRow(Swar *s, uint64_t *from, uint64_t *to, int j);
+static void swarBorder(Swar *s, uint64_t *cells, int j);
+static void swarEdge(Swar *s, uint64_t *ghost, uint64_t *row);
+static uint64_t getBit(uint64_t *row, int i);
+
+Engine swarEngine = {"swar", swarCreate, swarStep, swarStore, swarDestroy,
+		     swarJump, swarBlank, swarLive, swarChanges,
+		     swarStoreArea, swarStats, 1, 1};
+
+/**
+ * Pack the grid into rows of 64-bit words.
+ *
+ * @param g Grid
+ * @return The new engine state
+ */
+static void *swarCreate(Grid *g){
+  Swar *s;
+  int i, j;
+  uint64_t *row;
+  s = (Swar *)swarBlank(g->x, g->y);
+  for(j = 0; j < g->y; j++){
+    row = s->cells + (size_t)(j + 1) * s->stride + 1;
+    for(i = 0; i < g->x; i++){
+      if(CELL(g, i, j) == ALIVE){
+	row[i / WORD_BITS] |= 1ULL << (i % WORD_BITS);
+      }
+    }
+  }
+  return s;
+}
+/**
+ * Create a packed engine with every cell dead.
+ * Rows are counted as they are stepped if lifeStats is set, with the
+ * population count instruction when the CPU has one, and their
+ * changed squares marked if lifeChanges is.
+ *
+ * @param x Number of columns
+ * @param y Number of rows
+ * @return The new engine state
+ */
+static void *swarBlank(int x, int y){
+  Swar *s;
+  s = (Swar *)malloc(sizeof(Swar));
+  if(s == NULL){
+    printf("Cannot Allocate Engine\n");
+    exit(2);
+  }
+  s->x = x;
+  s->y = y;
+  s->words = (x + WORD_BITS - 1) / WORD_BITS;
+  s->stride = s->words + 2;
+  s->lastMask = ~0ULL >> (s->words * WORD_BITS - x);
+  s->topology = lifeTopology;
+  compileTerms(&lifeRule, &s->terms);
+  /* Guard rows and words are zeroed once, and only written when the
+     edges wrap */
+  s->cells = (uint64_t *)calloc((size_t)(y + 2) * s->stride, sizeof(uint64_t));
+  s->next = (uint64_t *)calloc((size_t)(y + 2) * s->stride, sizeof(uint64_t));
+  s->rows = lifeStats ? (RowStats *)calloc(y, sizeof(RowStats)) : NULL;
+  s->changes = newChanges(x, y);
+  s->count = countPlain;
+#ifdef SWAR_X86
+  __builtin_cpu_init();
+  if(__builtin_cpu_supports("popcnt")){
+    s->count = countPopcnt;
+  }
+#endif
+  if(s->cells == NULL || s->next == NULL || (lifeStats && s->rows == NULL)){
+    printf("Cannot Allocate Engine\n");
+    exit(2);
+  }
+  return s;
+}
+/**
+ * Make a run of cells alive, a word at a time.
+ *
+ * @param state Engine state
+ * @param i First column of the run
+ * @param j Row
+ * @param n Length of the run
+ */
+static void swarLive(void *state, int i, int j, int n){
+  Swar *s;
+  uint64_t *row;
+  int bit, take;
+  s = (Swar *)state;
+  row = s->cells + (size_t)(j + 1) * s->stride + 1;
+  while(n > 0){
+    bit = i % WORD_BITS;
+    take = WORD_BITS - bit < n ? WORD_BITS - bit : n;
+    row[i / WORD_BITS] |= (take == WORD_BITS ? ~0ULL : (1ULL << take) - 1) << bit;
+    i += take;
+    n -= take;
+  }
+}
+/**
+ * Calculate the next generation.
+ *
+ * @param state Engine state
+ */
+static void swarStep(void *state){
+  swarJump(state, 1);
+}
+/**
+ * Calculate a number of generations in bands across the thread pool.
+ * The buffers take turns as source and destination, so after an odd
+ * number of generations they are swapped. The border is filled once
+ * here, the bands keep it up to date after that.
+ *
+ * @param state Engine state
+ * @param generations Number of generations
+ */
+static void swarJump(void *state, uint64_t generations){
+  Swar *s;
+  uint64_t *temp;
+  int j;
+  s = (Swar *)state;
+  for(j = 1; j <= s->y && s->topology != TOPOLOGY_DEAD; j++){
+    swarBorder(s, s->cells, j);
+  }
+  poolRun(swarBand, s, s->y, generations);
+  if(generations % 2 == 1){
+    temp = s->cells;
+    s->cells = s->next;
+    s->next = temp;
+  }
+}
+/**
+ * Calculate one generation of a band of rows.
+ *
+ * @param state Engine state
+ * @param generation Generation of the job, even ones read cells
+ * @param row0 First row of the band
+ * @param row1 Row after the band
+ */
+static void swarBand(void *state, uint64_t generation, int row0, int row1){
+  Swar *s;
+  uint64_t *from, *to;
+  int j;
+  s = (Swar *)state;
+  from = generation % 2 == 0 ? s->cells : s->next;
+  to = generation % 2 == 0 ? s->next : s->cells;
+  for(j = row0 + 1; j <= row1; j++){
+    swarRow(s, from, to, j);
+    /* Only this band writes the row, so it can fill the row's border */
+    swarBorder(s, to, j);
+  }
+}
+/**
+ * Calculate the next generation of one row.
+ *
+ * @param s Engine state
+ * @param from Buffer of the current generation
+ * @param to Buffer of the next generation
+ * @param j Row, counted from 1 past the guard row
+ */
+static void swarRow(Swar *s, uint64_t *from, uint64_t *to, int j){
+  uint64_t *up, *row, *down, *out;
+  int k;
+  row = from + (size_t)j * s->stride + 1;
+  up = row - s->stride;
+  down = row + s->stride;
+  out = to + (size_t)j * s->stride + 1;
+  /* Chosen once per row, so Conway's rule keeps its own kernel */
+  if(s->terms.conway){
+    for(k = 0; k < s->words; k++){
+      out[k] = swarWord(NULL, up[k - 1], up[k], up[k + 1],
+			row[k - 1], row[k], row[k + 1],
+			down[k - 1], down[k], down[k + 1]);
+    }
+  }
+  else{
+    for(k = 0; k < s->words; k++){
+      out[k] = swarWord(&s->terms, up[k - 1], up[k], up[k + 1],
+			row[k - 1], row[k], row[k + 1],
+			down[k - 1], down[k], down[k + 1]);
+    }
+  }
+  /* Cells past the right edge must stay dead */
+  out[s->words - 1] &= s->lastMask;
+  if(s->rows != NULL){
+    s->count(out, row, s->words, s->lastMask, &s->rows[j - 1]);
+  }
+  if(s->changes != NULL){
+    markWords(out, row, s->words, s->lastMask,
+	      s->changes + (size_t)(j - 1) * changeWords(s->x));
+  }
+}
+/**
+ * Count one row against the row before it, 64 cells at a time.
+ * Births and deaths together are the cells that changed, so three
+ * population counts a word are enough. The ends of the live cells
+ * are found afterwards from the first and last live words.
+ *
+ * @param now Row in the new generation
+ * @param before Row in the generation before
+ * @param words Words in the row
+ * @param lastMask Cells of the last word on the board, as the word
+ * before may hold a wrapped cell past the edge
+ * @param r Set to the counts of the row
+ */
+static inline void countWords(const uint64_t *now, const uint64_t *before,
+			      int words, uint64_t lastMask, RowStats *r){
+  uint64_t n, c;
+  int k, population, births, changed;
+  population = births = changed = 0;
+  for(k = 0; k < words; k++){
+    n = now[k];
+    c = k == words - 1 ? before[k] & lastMask : before[k];
+    population += __builtin_popcountll(n);
+    births += __builtin_popcountll(n & ~c);
+    changed += __builtin_popcountll(n ^ c);
+  }
+  r->population = population;
+  r->births = births;
+  r->deaths = changed - births;
+  r->left = r->right = -1;
+  for(k = 0; k < words && now[k] == 0; k++);
+  if(k < words){
+    r->left = k * WORD_BITS + __builtin_ctzll(now[k]);
+    for(k = words - 1; now[k] == 0; k--);
+    r->right = k * WORD_BITS + WORD_BITS - 1 - __builtin_clzll(now[k]);
+  }
+}
+/**
+ * Count a row with the population count done in software.
+ *
+ * @param now Row in the new generation
+ * @param before Row in the generation before
+ * @param words Words in the row
+ * @param lastMask Cells of the last word on the board
+ * @param r Set to the counts of the row
+ */
+static void countPlain(const uint64_t *now, const uint64_t *before,
+		       int words, uint64_t lastMask, RowStats *r){
+  countWords(now, before, words, lastMask, r);
+}
+#ifdef SWAR_X86
+/**
+ * Count a row with the population count instruction.
+ *
+ * @param now Row in the new generation
+ * @param before Row in the generation before
+ * @param words Words in the row
+ * @param lastMask Cells of the last word on the board
+ * @param r Set to the counts of the row
+ */
+__attribute__((target("popcnt")))
+static void countPopcnt(const uint64_t *now, const uint64_t *before,
+			int words, uint64_t lastMask, RowStats *r){
+  countWords(now, before, words, lastMask, r);
+}
+#endif
+/**
+ * Fill the guard bits of one row for the edges' topology, and the
+ * guard row across the edge when the row is the first or last.
+ * Only the top bit of the west guard word and the first bit past the
+ * last column are ever read as neighbours.
+ *
+ * @param s Engine state
+ * @param cells Buffer
+ * @param j Row, counted from 1 past the guard row
+ */
+static void swarBorder(Swar *s, uint64_t *cells, int j){
+  uint64_t *row;
+  if(s->topology == TOPOLOGY_DEAD){
+    return;
+  }
+  row = cells + (size_t)j * s->stride + 1;
+  row[-1] = getBit(row, s->x - 1) << (WORD_BITS - 1);
+  row[s->words - 1] &= s->lastMask;
+  if(s->x % WORD_BITS == 0){
+    row[s->words] = getBit(row, 0);
+  }
+  else{
+    row[s->words - 1] |= getBit(row, 0) << (s->x % WORD_BITS);
+  }
+  if(j == 1){
+    swarEdge(s, cells + (size_t)(s->y + 1) * s->stride, row - 1);
+  }
+  if(j == s->y){
+    swarEdge(s, cells, row - 1);
+  }
+}
+/**
+ * Copy a row and its guard bits into the guard row across the edge,
+ * mirrored a bit at a time on a Klein bottle.
+ *
+ * @param s Engine state
+ * @param ghost Guard row, from its west guard word
+ * @param row Row, from its west guard word
+ */
+static void swarEdge(Swar *s, uint64_t *ghost, uint64_t *row){
+  int i;
+  if(s->topology == TOPOLOGY_KLEIN){
+    memset(ghost, 0, sizeof(uint64_t) * s->stride);
+    for(i = -1; i <= s->x; i++){
+      ghost[(i + WORD_BITS) / WORD_BITS] |=
+	getBit(row + 1, s->x - 1 - i) << ((i + WORD_BITS) % WORD_BITS);
+    }
+  }
+  else{
+    memcpy(ghost, row, sizeof(uint64_t) * s->stride);
+  }
+}
+/**
+ * One cell of a row, counting the guard bits either side.
+ *
+ * @param row Row
+ * @param i Column, from -1 to the number of columns
+ * @return 1 if the cell is alive, 0 otherwise
+ */
+static uint64_t getBit(uint64_t *row, int i){
+  return (row[(i + WORD_BITS) / WORD_BITS - 1] >> ((i + WORD_BITS) % WORD_BITS)) & 1;
+}
+/**
+ * Unpack the current generation into the grid.
+ * Cycle detection and the census store every generation, so on a
+ * little-endian machine eight cells are written at once.
+ *
+ * @param state Engine state
+ * @param g Grid
+ */
+static void swarStore(void *state, Grid *g){
+  Swar *s;
+  s = (Swar *)state;
+  swarStoreArea(state, g, 0, 0, s->x, s->y);
+}
+/**
+ * Unpack part of the board into the grid, eight cells at a time from
+ * the first whole byte of cells.
+ *
+ * @param state Engine state
+ * @param g Grid
+ * @param i0 First column
+ * @param j0 First row
+ * @param i1 Column after the area
+ * @param j1 Row after the area
+ */
+static void swarStoreArea(void *state, Grid *g, int i0, int j0,
+			  int i1, int j1){
+  Swar *s;
+  int i, j;
+  uint64_t *row, cells;
+  s = (Swar *)state;
+  for(j = j0; j < j1; j++){
+    row = s->cells + (size_t)(j + 1) * s->stride + 1;
+    i = i0;
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    for(; i % 8 != 0 && i < i1; i++){
+      CELL(g, i, j) = (row[i / WORD_BITS] >> (i % WORD_BITS)) & 1 ? ALIVE : DEAD;
+    }
+    for(; i + 8 <= i1; i += 8){
+      cells = spreadByte((row[i / WORD_BITS] >> (i % WORD_BITS)) & 0xFF);
+      memcpy(&CELL(g, i, j), &cells, 8);
+    }
+#endif
+    for(; i < i1; i++){
+      CELL(g, i, j) = (row[i / WORD_BITS] >> (i % WORD_BITS)) & 1 ? ALIVE : DEAD;
+    }
+  }
+}
+/**
+ * Spread eight cells into eight characters, the first cell in the
+ * lowest byte. Each byte of the product holds all eight cells, the
+ * mask keeps cell k in byte k, and adding 0x7F carries any set bit
+ * into the byte's top bit without reaching the next byte.
+ *
+ * @param bits Cells, the first in the lowest bit
+ * @return ALIVE or DEAD in each byte
+ */
+static uint64_t spreadByte(uint64_t bits){
+  uint64_t live;
+  live = (((bits * SPREAD_MULTIPLIER) & SPREAD_BITS) + SPREAD_CARRY) & SPREAD_TOP;
+  return (DEAD * SPREAD_MULTIPLIER) ^ ((live >> 7) * (ALIVE ^ DEAD));
+}
+/**
+ * Set the squares changed since they were last asked for.
+ *
+ * @param state Engine state
+ * @param tiles Squares, set to 1 where cells changed
+ */
+static void swarChanges(void *state, unsigned char *tiles){
+  Swar *s;
+  s = (Swar *)state;
+  sumChanges(s->changes, s->x, s->y, tiles);
+}
+/**
+ * Sum the counts of the rows from the last step.
+ *
+ * @param state Engine state
+ * @param stats Set to the statistics
+ */
+static void swarStats(void *state, Stats *stats){
+  Swar *s;
+  s = (Swar *)state;
+  sumRows(s->rows, s->y, stats);
+}
+/**
+ * Free the engine state.
+ *
+ * @param state Engine state
+ */
+static void swarDestroy(void *state){
+  Swar *s;
+  s = (Swar *)state;
+  free(s->cells);
+  free(s->next);
+  free(s->rows);
+  free(s->changes);
+  free(s);
+}
@@ -0,0 +1,153 @@
+/**
+ * @file swar.h
+ * @author YAN SUN
+ * @version 1.0
+ *
+ * @section DESCRIPTION
+ * Bit-sliced rules shared by the engines that pack 64 cells
+ * into a uint64_t. Conway's rule has its own few instructions,
+ * any other rule is compiled into terms matched against the count.
+ */
+#ifndef SWAR_H
+#define SWAR_H
+
+#include <stdint.h>
+#include "life.h"
+
+/* A rule compiled for the bit-sliced count */
+struct ruleTerms{
+  int conway;
+  int count;
+  /* Per term, all ones where bit b of its neighbour count is set */
+  uint64_t bit[9][4];
+  /* Per term, all ones if dead or live cells with that count live */
+  uint64_t dead[9];
+  uint64_t live[9];
+};
+typedef struct ruleTerms RuleTerms;
+
+/**
+ * Compile a rule into one term for each neighbour count it uses.
+ *
+ * @param rule Rule
+ * @param t Terms
+ */
+static inline void compileTerms(Rule *rule, RuleTerms *t){
+  int k, b;
+  t->conway = isConway(rule);
+  t->count = 0;
+  for(k = 0; k <= 8; k++){
+    if((rule->birth | rule->survive) & 1 << k){
+      for(b = 0; b < 4; b++){
+	t->bit[t->count][b] = (k >> b) & 1 ? ~0ULL : 0;
+      }
+      t->dead[t->count] = rule->birth & 1 << k ? ~0ULL : 0;
+      t->live[t->count] = rule->survive & 1 << k ? ~0ULL : 0;
+      t->count++;
+    }
+  }
+}
+
+/**
+ * Add up the neighbours of 64 cells at once.
+ * The eight neighbour bits are summed with full and half adders
+ * into a 4-bit count held across ones, twos, fours and eights.
+ *
+ * @param n0 Neighbours in one direction, n1 to n7 the others
+ * @param count Set to the four bits of the count
+ */
+static inline void swarCount(uint64_t n0, uint64_t n1, uint64_t n2,
+			     uint64_t n3, uint64_t n4, uint64_t n5,
+			     uint64_t n6, uint64_t n7, uint64_t count[4]){
+  uint64_t sa, ca, sb, cb, sc, cc, cd, t, ce, cf;
+  /* Three full adders and a half adder on the inputs */
+  sa = n0 ^ n1 ^ n2;
+  ca = (n0 & n1) | (n2 & (n0 ^ n1));
+  sb = n3 ^ n4 ^ n5;
+  cb = (n3 & n4) | (n5 & (n3 ^ n4));
+  sc = n6 ^ n7;
+  cc = n6 & n7;
+  /* Bit 0 of the count */
+  count[0] = sa ^ sb ^ sc;
+  cd = (sa & sb) | (sc & (sa ^ sb));
+  /* Bit 1 from the four carries */
+  t = ca ^ cb ^ cc;
+  ce = (ca & cb) | (cc & (ca ^ cb));
+  count[1] = t ^ cd;
+  cf = t & cd;
+  /* Bits 2 and 3 */
+  count[2] = ce ^ cf;
+  count[3] = ce & cf;
+}
+
+/**
+ * Apply Conway's rule to 64 cells at once.
+ *
+ * @param alive Current cells
+ * @param n0 Neighbours in one direction, n1 to n7 the others
+ * @return Next generation of the 64 cells
+ */
+static inline uint64_t swarRule(uint64_t alive,
+				uint64_t n0, uint64_t n1, uint64_t n2,
+				uint64_t n3, uint64_t n4, uint64_t n5,
+				uint64_t n6, uint64_t n7){
+  uint64_t count[4];
+  swarCount(n0, n1, n2, n3, n4, n5, n6, n7, count);
+  /* Count of 3, or 2 for a live cell */
+  return count[1] & ~count[2] & ~count[3] & (count[0] | alive);
+}
+
+/**
+ * Apply any rule to 64 cells at once.
+ * Each term matches the cells whose count is its count exactly.
+ *
+ * @param t Compiled rule
+ * @param alive Current cells
+ * @param n0 Neighbours in one direction, n1 to n7 the others
+ * @return Next generation of the 64 cells
+ */
+static inline uint64_t swarTerms(const RuleTerms *t, uint64_t alive,
+				 uint64_t n0, uint64_t n1, uint64_t n2,
+				 uint64_t n3, uint64_t n4, uint64_t n5,
+				 uint64_t n6, uint64_t n7){
+  uint64_t count[4], next, match;
+  int k;
+  swarCount(n0, n1, n2, n3, n4, n5, n6, n7, count);
+  next = 0;
+  for(k = 0; k < t->count; k++){
+    match = ~((count[0] ^ t->bit[k][0]) | (count[1] ^ t->bit[k][1]) |
+	      (count[2] ^ t->bit[k][2]) | (count[3] ^ t->bit[k][3]));
+    next |= match & ((alive & t->live[k]) | (~alive & t->dead[k]));
+  }
+  return next;
+}
+
+/**
+ * Next generation of a word from the words around it.
+ * Bit i of a word is cell 64k + i, so shifting a word left by one
+ * lines every cell up with its left neighbour; the bit shifted in
+ * comes from the word to the west.
+ *
+ * @param t Compiled rule, NULL for Conway's
+ * @param uw North-west word, u north and ue north-east
+ * @param w West word, c the word itself and e east
+ * @param dw South-west word, d south and de south-east
+ * @return Next generation of c
+ */
+static inline uint64_t swarWord(const RuleTerms *t,
+				uint64_t uw, uint64_t u, uint64_t ue,
+				uint64_t w, uint64_t c, uint64_t e,
+				uint64_t dw, uint64_t d, uint64_t de){
+  if(t == NULL){
+    return swarRule(c,
+		    (u << 1) | (uw >> 63), u, (u >> 1) | (ue << 63),
+		    (c << 1) | (w >> 63), (c >> 1) | (e << 63),
+		    (d << 1) | (dw >> 63), d, (d >> 1) | (de << 63));
+  }
+  return swarTerms(t, c,
+		   (u << 1) | (uw >> 63), u, (u >> 1) | (ue << 63),
+		   (c << 1) | (w >> 63), (c >> 1) | (e << 63),
+		   (d << 1) | (dw >> 63), d, (d >> 1) | (de << 63));
+}
+
+#endif
@@ -0,0 +1,667 @@
+/**
+ * @file tiled.c
+ * @author YAN SUN
+ * @version 1.0
+ *
+ * @section DESCRIPTION
+ * Out-of-core Game of Life engine for boards larger than memory.
+ * The board lives in a file of square tiles, TILE_SIDE cells a side,
+ * each tile's rows packed 64 cells to a word like the swar engine's.
+ * A generation reads one file and writes the next, then the two swap.
+ * The board is worked in strips of tile columns, each strip from top
+ * to bottom a band (a row of tiles) at a time. A band of the next
+ * generation needs the bands above and below it in the current one,
+ * and its strip a tile column either side, so those are read with it.
+ * A reader thread reads bands ahead while the pool calculates, and a
+ * writer thread writes the finished bands behind it. Both live as long
+ * as the engine, waiting between generations. The strips are
+ * as wide as the memory budget allows, so only the halo columns are
+ * read twice. Both files are unlinked as soon as they are made.
+ * Rows loaded into the engine or taken out of it go through the first
+ * read band, idle between generations, as many rows of the whole
+ * board at a time as it holds, so they stay within the budget too.
+ */
+#define _POSIX_C_SOURCE 200809L
+#define _FILE_OFFSET_BITS 64
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "life.h"
+#include "swar.h"
+
+#define WORD_BITS 64
+#define TILE_SIDE 512
+#define TILE_WORDS (TILE_SIDE / WORD_BITS)
+#define TILE_BYTES ((size_t)TILE_SIDE * TILE_WORDS * sizeof(uint64_t))
+/* Bands of the current generation held at once: the three a band of
+   the next is made from and one read ahead */
+#define TILED_READ 4
+/* Bands of the next generation held at once: one being made and one
+   being written */
+#define TILED_WRITE 2
+#define MEGABYTE (1024 * 1024)
+#define DEFAULT_MEGABYTES 256
+#define NAME_LENGTH 4096
+
+struct tiled{
+  int x;
+  int y;
+  /* Tiles across and down the board */
+  int across;
+  int down;
+  /* Words in a row of the board */
+  int boardWords;
+  uint64_t lastMask;
+  /* Tile columns in a strip, and words in a row of a band read, which
+     has the strip's halo tile either side */
+  int width;
+  int strips;
+  int words;
+  RuleTerms terms;
+  /* File of the current generation, then of the next */
+  int files[2];
+  uint64_t *read[TILED_READ];
+  uint64_t *write[TILED_WRITE];
+  /* A row of dead cells, above the first band and below the last */
+  uint64_t *dead;
+  /* Tiles being gathered by the reader and by the writer */
+  uint64_t *readTile;
+  uint64_t *writeTile;
+  /* Rows of the whole board staged at once in the first read band,
+     a power of two so they never cross a band of tiles, and the
+     chunk of them being filled by live, -1 when there is none */
+  int chunk;
+  int pending;
+  /* Generations started, and bands counted through every generation
+     since the engine was made, strip after strip */
+  pthread_mutex_t lock;
+  pthread_cond_t moved;
+  uint64_t started;
+  uint64_t bandsRead;
+  uint64_t bandsFreed;
+  uint64_t bandsMade;
+  uint64_t bandsWritten;
+  /* Set to stop the reader and writer */
+  int stop;
+  pthread_t reader;
+  pthread_t writer;
+  /* Band being made by the pool: its rows of the current generation
+     above, itself and below, its strip and band */
+  const uint64_t *up;
+  const uint64_t *middle;
+  const uint64_t *below;
+  uint64_t *out;
+  int strip;
+  int band;
+};
+typedef struct tiled Tiled;
+
+static void *tiledCreate(Grid *g);
+static void *tiledBlank(int x, int y);
+static void tiledLive(void *state, int i, int j, int n);
+static void tiledStep(void *state);
+static void tiledJump(void *state, uint64_t generations);
+static void tiledGeneration(Tiled *s);
+static void tiledBand(void *state, uint64_t generation, int row0, int row1);
+static void *readBands(void *arg);
+static void *writeBands(void *arg);
+static int waitFor(Tiled *s, uint64_t *count, uint64_t value);
+static void advance(Tiled *s, uint64_t *count, uint64_t by);
+static void flushPending(Tiled *s);
+static void readTile(Tiled *s, int file, int band, int column, int row,
+		     int rows, uint64_t *tile);
+static void writeTile(Tiled *s, int file, int band, int column, int row,
+		      int rows, const uint64_t *tile);
+static void tiledStore(void *state, Grid *g);
+static void tiledDestroy(void *state);
+static int scratchFile(void);
+static uint64_t *allocateWords(size_t words);
+
+Engine tiledEngine = {"tiled", tiledCreate, tiledStep, tiledStore,
+		      tiledDestroy, tiledJump, tiledBlank, tiledLive,
+		      NULL, NULL, NULL, 1, 0};
+
+/* Settings from tiledInit, used by each new engine */
+static char *tiledDirectory = ".";
+static size_t tiledBudget = (size_t)DEFAULT_MEGABYTES * MEGABYTE;
+
+/**
+ * Set up the tiled engines created from now on.
+ *
+ * @param directory Where the tile files go, NULL for the current one
+ * @param megabytes Memory for bands, 0 for the default
+ */
+void tiledInit(char *directory, size_t megabytes){
+  tiledDirectory = directory != NULL ? directory : ".";
+  tiledBudget = (megabytes ? megabytes : DEFAULT_MEGABYTES) * (size_t)MEGABYTE;
+}
+/**
+ * Write the grid into the tile file.
+ *
+ * @param g Grid
+ * @return The new engine state
+ */
+static void *tiledCreate(Grid *g){
+  Tiled *s;
+  int i, j;
+  s = (Tiled *)tiledBlank(g->x, g->y);
+  for(j = 0; j < g->y; j++){
+    for(i = 0; i < g->x; i++){
+      if(CELL(g, i, j) == ALIVE){
+	tiledLive(s, i, j, 1);
+      }
+    }
+  }
+  return s;
+}
+/**
+ * Create a tiled engine with every cell dead.
+ * The files start empty, and read back as dead tiles until written.
+ * Each band of a strip is (width + 2) tiles read and width tiles
+ * written, so the width is the most the budget holds, at least one
+ * tile. A row of the whole board must fit in the first read band to
+ * be staged, so a board more than TILE_SIDE * (width + 2) tiles wide
+ * is refused.
+ *
+ * @param x Number of columns
+ * @param y Number of rows
+ * @return The new engine state
+ */
+static void *tiledBlank(int x, int y){
+  Tiled *s;
+  size_t tiles;
+  int k;
+  s = (Tiled *)malloc(sizeof(Tiled));
+  if(s == NULL){
+    printf("Cannot Allocate Engine\n");
+    exit(2);
+  }
+  s->x = x;
+  s->y = y;
+  s->across = (x + TILE_SIDE - 1) / TILE_SIDE;
+  s->down = (y + TILE_SIDE - 1) / TILE_SIDE;
+  s->boardWords = (x + WORD_BITS - 1) / WORD_BITS;
+  s->lastMask = ~0ULL >> (s->boardWords * WORD_BITS - x);
+  tiles = tiledBudget / TILE_BYTES;
+  tiles = tiles > 2 * TILED_READ + 2 ? tiles - 2 * TILED_READ - 2 : 0;
+  s->width = (int)(tiles / (TILED_READ + TILED_WRITE));
+  s->width = s->width < 1 ? 1 : s->width > s->across ? s->across : s->width;
+  s->strips = (s->across + s->width - 1) / s->width;
+  s->words = (s->width + 2) * TILE_WORDS;
+  compileTerms(&lifeRule, &s->terms);
+  s->files[0] = scratchFile();
+  s->files[1] = scratchFile();
+  for(k = 0; k < TILED_READ; k++){
+    s->read[k] = allocateWords((size_t)TILE_SIDE * s->words);
+  }
+  for(k = 0; k < TILED_WRITE; k++){
+    s->write[k] = allocateWords((size_t)TILE_SIDE * s->width * TILE_WORDS);
+  }
+  if((size_t)s->across > (size_t)TILE_SIDE * (s->width + 2)){
+    printf("Cannot Fit A Row Of The Board In %lu Megabytes\n",
+	   (unsigned long)(tiledBudget / MEGABYTE));
+    exit(2);
+  }
+  s->chunk = TILE_SIDE;
+  while((size_t)s->chunk * s->across > (size_t)TILE_SIDE * (s->width + 2)){
+    s->chunk /= 2;
+  }
+  s->dead = allocateWords(s->words);
+  s->readTile = allocateWords((size_t)TILE_SIDE * TILE_WORDS);
+  s->writeTile = allocateWords((size_t)TILE_SIDE * TILE_WORDS);
+  s->pending = -1;
+  s->started = 0;
+  s->bandsRead = s->bandsFreed = s->bandsMade = s->bandsWritten = 0;
+  s->stop = 0;
+  pthread_mutex_init(&s->lock, NULL);
+  pthread_cond_init(&s->moved, NULL);
+  if(pthread_create(&s->reader, NULL, readBands, s) != 0 ||
+     pthread_create(&s->writer, NULL, writeBands, s) != 0){
+    printf("Cannot Start Threads\n");
+    exit(2);
+  }
+  return s;
+}
+/**
+ * Make a run of cells alive. The rows arrive in order, so a chunk of
+ * them is only written to the file once the rows move past it.
+ *
+ * @param state Engine state
+ * @param i First column of the run
+ * @param j Row
+ * @param n Length of the run
+ */
+static void tiledLive(void *state, int i, int j, int n){
+  Tiled *s;
+  uint64_t *row;
+  int bit, take;
+  s = (Tiled *)state;
+  if(j / s->chunk != s->pending){
+    flushPending(s);
+    s->pending = j / s->chunk;
+    memset(s->read[0], 0,
+	   sizeof(uint64_t) * s->chunk * s->across * TILE_WORDS);
+  }
+  row = s->read[0] + (size_t)(j % s->chunk) * s->across * TILE_WORDS;
+  while(n > 0){
+    bit = i % WORD_BITS;
+    take = WORD_BITS - bit < n ? WORD_BITS - bit : n;
+    row[i / WORD_BITS] |= (take == WORD_BITS ? ~0ULL : (1ULL << take) - 1) << bit;
+    i += take;
+    n -= take;
+  }
+}
+/**
+ * Calculate the next generation.
+ *
+ * @param state Engine state
+ */
+static void tiledStep(void *state){
+  tiledJump(state, 1);
+}
+/**
+ * Calculate a number of generations, a pass over the files each.
+ *
+ * @param state Engine state
+ * @param generations Number of generations
+ */
+static void tiledJump(void *state, uint64_t generations){
+  Tiled *s;
+  uint64_t g;
+  int file;
+  s = (Tiled *)state;
+  flushPending(s);
+  for(g = 0; g < generations; g++){
+    tiledGeneration(s);
+    file = s->files[0];
+    s->files[0] = s->files[1];
+    s->files[1] = file;
+  }
+}
+/**
+ * Calculate one generation from the current file into the next.
+ * Band k of a generation is band k % down of strip k / down. A band
+ * read is freed once the band below it has been made, so the reader
+ * holds at most TILED_READ of them, and the writer at most TILED_WRITE
+ * made ones. The generation is over once its last band is written.
+ *
+ * @param s Engine state
+ */
+static void tiledGeneration(Tiled *s){
+  uint64_t first, base, needed;
+  int strip, band;
+  first = s->started * s->strips * s->down;
+  advance(s, &s->started, 1);
+  for(strip = 0; strip < s->strips; strip++){
+    base = first + (uint64_t)strip * s->down;
+    for(band = 0; band < s->down; band++){
+      needed = base + band + (band + 1 < s->down ? 2 : 1);
+      waitFor(s, &s->bandsRead, needed);
+      waitFor(s, &s->bandsWritten, s->bandsMade + 1 > TILED_WRITE ?
+	      s->bandsMade + 1 - TILED_WRITE : 0);
+      s->middle = s->read[(base + band) % TILED_READ];
+      s->up = band > 0 ?
+	s->read[(base + band - 1) % TILED_READ] + (size_t)(TILE_SIDE - 1) * s->words :
+	s->dead;
+      s->below = band + 1 < s->down ? s->read[(base + band + 1) % TILED_READ] :
+	s->dead;
+      s->out = s->write[s->bandsMade % TILED_WRITE];
+      s->strip = strip;
+      s->band = band;
+      poolRun(tiledBand, s, TILE_SIDE, 1);
+      advance(s, &s->bandsMade, 1);
+      /* The last band of a strip frees the one above it and itself */
+      advance(s, &s->bandsFreed, (band > 0) + (band + 1 == s->down));
+    }
+  }
+  waitFor(s, &s->bandsWritten, s->bandsMade);
+}
+/**
+ * Calculate some rows of the band being made.
+ * Only the words on the board are calculated, the rest stay dead.
+ *
+ * @param state Engine state
+ * @param generation Unused, the pool runs one generation at a time
+ * @param row0 First row of the band
+ * @param row1 Row after the band
+ */
+static void tiledBand(void *state, uint64_t generation, int row0, int row1){
+  Tiled *s;
+  const uint64_t *up, *row, *down;
+  const RuleTerms *terms;
+  uint64_t *out;
+  int j, k, words, first;
+  s = (Tiled *)state;
+  (void)generation;
+  terms = s->terms.conway ? NULL : &s->terms;
+  first = s->strip * s->width * TILE_WORDS;
+  words = s->boardWords - first;
+  words = words < s->width * TILE_WORDS ? words : s->width * TILE_WORDS;
+  for(j = row0; j < row1; j++){
+    out = s->out + (size_t)j * s->width * TILE_WORDS;
+    memset(out, 0, sizeof(uint64_t) * s->width * TILE_WORDS);
+    if(s->band * TILE_SIDE + j >= s->y){
+      continue;
+    }
+    row = s->middle + (size_t)j * s->words + TILE_WORDS;
+    up = j > 0 ? row - s->words : s->up + TILE_WORDS;
+    down = j + 1 < TILE_SIDE ? row + s->words : s->below + TILE_WORDS;
+    for(k = 0; k < words; k++){
+      out[k] = swarWord(terms, up[k - 1], up[k], up[k + 1],
+			row[k - 1], row[k], row[k + 1],
+			down[k - 1], down[k], down[k + 1]);
+    }
+    /* Cells past the right edge must stay dead */
+    if(first + words == s->boardWords){
+      out[words - 1] &= s->lastMask;
+    }
+  }
+}
+/**
+ * Read the bands of each generation in order, once it is started,
+ * each with its strip's halo tiles, a tile off the board or past the
+ * strip left dead.
+ *
+ * @param arg Engine state
+ * @return NULL
+ */
+static void *readBands(void *arg){
+  Tiled *s;
+  uint64_t k, total, *cells;
+  int strip, band, t, column, row;
+  s = (Tiled *)arg;
+  total = (uint64_t)s->strips * s->down;
+  for(k = 0; ; k++){
+    if(k % total == 0 && !waitFor(s, &s->started, k / total + 1)){
+      return NULL;
+    }
+    waitFor(s, &s->bandsFreed, k + 1 > TILED_READ ? k + 1 - TILED_READ : 0);
+    strip = (int)(k % total / s->down);
+    band = (int)(k % s->down);
+    cells = s->read[k % TILED_READ];
+    for(t = 0; t < s->width + 2; t++){
+      column = strip * s->width - 1 + t;
+      if(column >= 0 && column < s->across){
+	readTile(s, s->files[0], band, column, 0, TILE_SIDE, s->readTile);
+      }
+      else{
+	memset(s->readTile, 0, TILE_BYTES);
+      }
+      for(row = 0; row < TILE_SIDE; row++){
+	memcpy(cells + (size_t)row * s->words + t * TILE_WORDS,
+	       s->readTile + row * TILE_WORDS, TILE_WORDS * sizeof(uint64_t));
+      }
+    }
+    advance(s, &s->bandsRead, 1);
+  }
+}
+/**
+ * Write the bands of each generation as they are made, tile by tile.
+ *
+ * @param arg Engine state
+ * @return NULL
+ */
+static void *writeBands(void *arg){
+  Tiled *s;
+  uint64_t k, total, *cells;
+  int strip, band, t, column, row;
+  s = (Tiled *)arg;
+  total = (uint64_t)s->strips * s->down;
+  for(k = 0; ; k++){
+    if(!waitFor(s, &s->bandsMade, k + 1)){
+      return NULL;
+    }
+    strip = (int)(k % total / s->down);
+    band = (int)(k % s->down);
+    cells = s->write[k % TILED_WRITE];
+    for(t = 0; t < s->width && strip * s->width + t < s->across; t++){
+      column = strip * s->width + t;
+      for(row = 0; row < TILE_SIDE; row++){
+	memcpy(s->writeTile + row * TILE_WORDS,
+	       cells + (size_t)row * s->width * TILE_WORDS + t * TILE_WORDS,
+	       TILE_WORDS * sizeof(uint64_t));
+      }
+      writeTile(s, s->files[1], band, column, 0, TILE_SIDE, s->writeTile);
+    }
+    advance(s, &s->bandsWritten, 1);
+  }
+}
+/**
+ * Wait until a count reaches a value, or the engine is stopped.
+ *
+ * @param s Engine state
+ * @param count Count
+ * @param value Value
+ * @return 1 when the count is reached, 0 when stopped
+ */
+static int waitFor(Tiled *s, uint64_t *count, uint64_t value){
+  int reached;
+  pthread_mutex_lock(&s->lock);
+  while(*count < value && !s->stop){
+    pthread_cond_wait(&s->moved, &s->lock);
+  }
+  reached = *count >= value;
+  pthread_mutex_unlock(&s->lock);
+  return reached;
+}
+/**
+ * Add to a count and wake whoever waits for it.
+ *
+ * @param s Engine state
+ * @param count Count
+ * @param by Amount added
+ */
+static void advance(Tiled *s, uint64_t *count, uint64_t by){
+  pthread_mutex_lock(&s->lock);
+  *count += by;
+  pthread_cond_broadcast(&s->moved);
+  pthread_mutex_unlock(&s->lock);
+}
+/**
+ * Write the rows filled by live into the current file. Tiles with no
+ * live cells in those rows are left as the file has them, dead.
+ *
+ * @param s Engine state
+ */
+static void flushPending(Tiled *s){
+  uint64_t any;
+  int column, row, k;
+  if(s->pending < 0){
+    return;
+  }
+  for(column = 0; column < s->across; column++){
+    any = 0;
+    for(row = 0; row < s->chunk; row++){
+      for(k = 0; k < TILE_WORDS; k++){
+	s->writeTile[row * TILE_WORDS + k] =
+	  s->read[0][((size_t)row * s->across + column) * TILE_WORDS + k];
+	any |= s->writeTile[row * TILE_WORDS + k];
+      }
+    }
+    if(any){
+      writeTile(s, s->files[0], s->pending * s->chunk / TILE_SIDE, column,
+		s->pending * s->chunk % TILE_SIDE, s->chunk, s->writeTile);
+    }
+  }
+  s->pending = -1;
+}
+/**
+ * Read rows of a tile, dead where the file has not been written.
+ *
+ * @param s Engine state
+ * @param file File
+ * @param band Band of the tile
+ * @param column Column of the tile
+ * @param row First row read
+ * @param rows Number of rows
+ * @param tile Set to the rows' words
+ */
+static void readTile(Tiled *s, int file, int band, int column, int row,
+		     int rows, uint64_t *tile){
+  off_t offset;
+  size_t done, bytes;
+  ssize_t n;
+  offset = ((off_t)band * s->across + column) * (off_t)TILE_BYTES +
+    (off_t)row * TILE_WORDS * sizeof(uint64_t);
+  bytes = (size_t)rows * TILE_WORDS * sizeof(uint64_t);
+  for(done = 0; done < bytes; done += n){
+    n = pread(file, (char *)tile + done, bytes - done, offset + done);
+    if(n < 0){
+      printf("Cannot Read Tiles\n");
+      exit(2);
+    }
+    if(n == 0){
+      memset((char *)tile + done, 0, bytes - done);
+      break;
+    }
+  }
+}
+/**
+ * Write rows of a tile.
+ *
+ * @param s Engine state
+ * @param file File
+ * @param band Band of the tile
+ * @param column Column of the tile
+ * @param row First row written
+ * @param rows Number of rows
+ * @param tile Words of the rows
+ */
+static void writeTile(Tiled *s, int file, int band, int column, int row,
+		      int rows, const uint64_t *tile){
+  off_t offset;
+  size_t done, bytes;
+  ssize_t n;
+  offset = ((off_t)band * s->across + column) * (off_t)TILE_BYTES +
+    (off_t)row * TILE_WORDS * sizeof(uint64_t);
+  bytes = (size_t)rows * TILE_WORDS * sizeof(uint64_t);
+  for(done = 0; done < bytes; done += n){
+    n = pwrite(file, (const char *)tile + done, bytes - done, offset + done);
+    if(n <= 0){
+      printf("Cannot Write Tiles\n");
+      exit(2);
+    }
+  }
+}
+/**
+ * Copy the current generation back into the grid.
+ *
+ * @param state Engine state
+ * @param g Grid
+ */
+static void tiledStore(void *state, Grid *g){
+  tiledRows(state, NULL, g);
+}
+/**
+ * Pass the rows of the current generation on one at a time, as
+ * pattern file cells, reading as many rows of tiles at once as are
+ * staged. With no function the rows are copied into a grid instead.
+ *
+ * @param state Engine state
+ * @param row Take the next row of the board, x cells
+ * @param arg Passed on to row, or the grid
+ */
+void tiledRows(void *state, void (*row)(void *arg, char *cells, int x),
+	       void *arg){
+  Tiled *s;
+  uint64_t *words;
+  char *line;
+  int first, column, j, i;
+  s = (Tiled *)state;
+  flushPending(s);
+  line = row != NULL ? (char *)malloc(s->x) : NULL;
+  if(row != NULL && line == NULL){
+    printf("Cannot Allocate Engine\n");
+    exit(2);
+  }
+  for(first = 0; first < s->y; first += s->chunk){
+    for(column = 0; column < s->across; column++){
+      readTile(s, s->files[0], first / TILE_SIDE, column, first % TILE_SIDE,
+	       s->chunk, s->readTile);
+      for(j = 0; j < s->chunk; j++){
+	memcpy(s->read[0] + ((size_t)j * s->across + column) * TILE_WORDS,
+	       s->readTile + j * TILE_WORDS, TILE_WORDS * sizeof(uint64_t));
+      }
+    }
+    for(j = first; j < s->y && j < first + s->chunk; j++){
+      words = s->read[0] + (size_t)(j - first) * s->across * TILE_WORDS;
+      if(row == NULL){
+	line = ((Grid *)arg)->cells + (size_t)j * s->x;
+      }
+      for(i = 0; i < s->x; i++){
+	line[i] = (words[i / WORD_BITS] >> (i % WORD_BITS)) & 1 ? ALIVE : DEAD;
+      }
+      if(row != NULL){
+	row(arg, line, s->x);
+      }
+    }
+  }
+  if(row != NULL){
+    free(line);
+  }
+}
+/**
+ * Stop the reader and writer, then close and free an engine state.
+ *
+ * @param state Engine state
+ */
+static void tiledDestroy(void *state){
+  Tiled *s;
+  int k;
+  s = (Tiled *)state;
+  pthread_mutex_lock(&s->lock);
+  s->stop = 1;
+  pthread_cond_broadcast(&s->moved);
+  pthread_mutex_unlock(&s->lock);
+  pthread_join(s->reader, NULL);
+  pthread_join(s->writer, NULL);
+  close(s->files[0]);
+  close(s->files[1]);
+  for(k = 0; k < TILED_READ; k++){
+    free(s->read[k]);
+  }
+  for(k = 0; k < TILED_WRITE; k++){
+    free(s->write[k]);
+  }
+  free(s->dead);
+  free(s->readTile);
+  free(s->writeTile);
+  pthread_mutex_destroy(&s->lock);
+  pthread_cond_destroy(&s->moved);
+  free(s);
+}
+/**
+ * Make a tile file in the tile directory. It is unlinked at once, so
+ * it goes when it is closed, even if the program does not get to it.
+ *
+ * @return File descriptor
+ */
+static int scratchFile(void){
+  char name[NAME_LENGTH];
+  int file;
+  if(snprintf(name, NAME_LENGTH, "%s/life.tiles.XXXXXX", tiledDirectory) >=
+     NAME_LENGTH || (file = mkstemp(name)) < 0){
+    printf("Cannot Make Tile File (%s)\n", tiledDirectory);
+    exit(2);
+  }
+  unlink(name);
+  return file;
+}
+/**
+ * Allocate zeroed words.
+ *
+ * @param words Number of words
+ * @return The words
+ */
+static uint64_t *allocateWords(size_t words){
+  uint64_t *p;
+  p = (uint64_t *)calloc(words, sizeof(uint64_t));
+  if(p == NULL){
+    printf("Cannot Allocate Engine\n");
+    exit(2);
+  }
+  return p;
+}
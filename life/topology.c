@@ -0,0 +1,121 @@
+/**
+ * @file topology.c
+ * @author YAN SUN
+ * @version 1.0
+ *
+ * @section DESCRIPTION
+ * What lies past the edge of a bounded board.
+ * The byte and bit engines keep a one-cell ghost border round the
+ * board so their kernels never test for an edge. With a dead edge
+ * the border is left dead. On a torus the ghost cells are copies of
+ * the cells across the board, and on a Klein bottle the rows above
+ * and below are also mirrored left to right. The border is filled
+ * before a step, and an engine running many generations in one call
+ * writes each row's border as soon as the row itself, so it is ready
+ * for the next generation without another pass.
+ * Only the scalar, swar and simd engines wrap: the sparse engine's
+ * tiles, the block engine's shifting blocks and the unbounded engines
+ * have no such border.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "life.h"
+
+static char *topologyNames[] = {"dead", "torus", "klein", NULL};
+
+/* Topology of the engines created from now on */
+int lifeTopology = TOPOLOGY_DEAD;
+
+/* Set when the topology came from the command line */
+static int topologyFixed = 0;
+
+/**
+ * Set the topology from the command line, it then wins over any
+ * in a checkpoint. Exit if it is not known.
+ *
+ * @param text "dead", "torus" or "klein", NULL for a dead edge
+ */
+void topologyInit(char *text){
+  int t;
+  if(text == NULL){
+    return;
+  }
+  for(t = 0; topologyNames[t] != NULL; t++){
+    if(strcmp(topologyNames[t], text) == 0){
+      lifeTopology = t;
+      topologyFixed = 1;
+      return;
+    }
+  }
+  printf("Unknown topology (%s). \n", text);
+  exit(1);
+}
+/**
+ * Set the topology saved with a pattern,
+ * unless one was given on the command line.
+ *
+ * @param topology Topology
+ */
+void patternTopology(int topology){
+  if(!topologyFixed){
+    lifeTopology = topology;
+  }
+}
+/**
+ * Name of a topology.
+ *
+ * @param topology Topology
+ * @return Its name
+ */
+char *topologyName(int topology){
+  return topologyNames[topology];
+}
+/**
+ * Fill the ghost cells of one row of a board of bytes, and the ghost
+ * row across the edge when the row is the first or last.
+ *
+ * @param cells Board, with a ghost row above and below
+ * @param x Number of columns
+ * @param y Number of rows
+ * @param stride Distance between rows
+ * @param j Row, counted from 1 past the ghost row
+ * @param topology Topology, nothing is written for a dead edge
+ */
+void borderBytes(unsigned char *cells, int x, int y, int stride, int j,
+		 int topology){
+  unsigned char *row;
+  row = cells + (size_t)j * stride + 1;
+  if(topology == TOPOLOGY_DEAD){
+    return;
+  }
+  row[-1] = row[x - 1];
+  row[x] = row[0];
+  if(j == 1){
+    edgeBytes(cells + (size_t)(y + 1) * stride, row - 1, x, topology);
+  }
+  if(j == y){
+    edgeBytes(cells, row - 1, x, topology);
+  }
+}
+/**
+ * Copy a row and its ghost cells into the ghost row across the edge,
+ * mirrored on a Klein bottle.
+ *
+ * @param ghost Ghost row, from its left ghost cell
+ * @param row Row, from its left ghost cell
+ * @param x Number of columns
+ * @param topology Topology
+ */
+void edgeBytes(unsigned char *ghost, const unsigned char *row, int x,
+	       int topology){
+  int k;
+  if(topology == TOPOLOGY_KLEIN){
+    for(k = 0; k < x + 2; k++){
+      ghost[k] = row[x + 1 - k];
+    }
+  }
+  else{
+    memcpy(ghost, row, x + 2);
+  }
+}
@@ -10,6 +10,8 @@
  */
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
 #include "neillsdl2.h"
 #define SIZE 5
 #define SUCCESS 1
@@ -29,9 +31,18 @@
 #define ON 1
 #define OFF 0
 #define MILLISECONDDELAY 800
+#define ZOBRIST_SEED 0x9E3779B97F4A7C15ULL
+#define READ_BUFFER 65536
+#define WRITE_BUFFER 65536
+#define BOARD_BYTES ((SIZE * SIZE + 7) / 8)
+#define NO_SOLUTION 255
+#define NO_MOVE -1
+#define FRAME_NAME 256
 
 struct node{
   char board[SIZE][SIZE];
+  uint64_t hash;
+  int move;
   int step;
   int flag;
   struct node *next;
@@ -45,11 +56,40 @@ struct queue{
 };
 typedef struct queue Queue;
 
+/* Buffered reader over a file holding one or more boards */
+struct reader{
+  FILE *file;
+  char buffer[READ_BUFFER];
+  int length;
+  int position;
+  int line;
+  int count;
+};
+typedef struct reader Reader;
+
+/* Search and output choices from the command line and version menu */
+struct options{
+  int sdl;
+  int mode;
+  FILE *out;
+  char *frames;
+  int sheet;
+  int board;
+};
+typedef struct options Options;
+
 int initialise(char board[SIZE][SIZE]);
-int readFile(FILE *file, char *argv[], char board[SIZE][SIZE]);
+int openReader(Reader *r, char *name);
+int closeReader(Reader *r);
+int readChar(Reader *r);
+int skipLine(Reader *r);
+int readHeader(Reader *r);
+int nextBoard(Reader *r, char board[SIZE][SIZE]);
+int readOptions(int argc, char *argv[], Options *opt);
+int solveBoard(char board[SIZE][SIZE], Options *opt);
 Node *moveDFS(char board[SIZE][SIZE], Node *start);
-int moveForward(char board[SIZE][SIZE], int direction, int x, int y);
-int moveBack(char board[SIZE][SIZE], int direction, int x, int y);
+int moveForward(char board[SIZE][SIZE], int direction, int x, int y, uint64_t *hash);
+int moveBack(char board[SIZE][SIZE], int direction, int x, int y, uint64_t *hash);
 int checkLeft(char board[SIZE][SIZE], int x, int y);
 int checkRight(char board[SIZE][SIZE], int x, int y);
 int checkUp(char board[SIZE][SIZE], int x, int y);
@@ -57,10 +97,15 @@ int checkDown(char board[SIZE][SIZE], int x, int y);
 int countPegs(char board[SIZE][SIZE]);
 int printBoard(char board[SIZE][SIZE]);
 int printSteps(Node *current);
-Node *AllocateNode(char board[SIZE][SIZE]);
-Node *storeBoard(char board[SIZE][SIZE], Node *current);
+int formatBoard(char board[SIZE][SIZE], char *text);
+int encodeMove(int direction, int x, int y);
+int writeHeader(FILE *out);
+int writeSolution(FILE *out, char board[SIZE][SIZE], Node *current);
+Node *AllocateNode(char board[SIZE][SIZE], uint64_t hash);
+Node *storeBoard(char board[SIZE][SIZE], uint64_t hash, Node *current);
 Node *reverseList(Node *list);
 int drawMove(Node* start);
+int exportFrames(Node *start, Options *opt);
 int drawBoard(char board[SIZE][SIZE], SDL_Simplewin sw);
 Node *moveBFS(Queue *q);
 Node *removeNode(Queue *q);
@@ -68,33 +113,122 @@ int insertNode(Queue *q, Node *p);
 int initQueue(Queue *q);
 int empty(Queue *q);
 int printQueue(Queue *q);
-double computeID(char board[SIZE][SIZE]);
+int initZobrist(void);
+uint64_t computeHash(char board[SIZE][SIZE]);
+uint64_t moveKey(int direction, int x, int y);
 int checkRepeat(Queue q, Node *p);
 int versionSelect(int *sdl, int *mode);
 int copyBoard(char toBoard[SIZE][SIZE],char fromBoard[SIZE][SIZE]);
 int checkWin(char board[SIZE][SIZE]);
 Node *storeParents(Node *nextNode, Node *p);
+int freeSearch(Node *start, int mode);
+
+/* Random key for a peg on each cell, filled by initZobrist() */
+uint64_t zobrist[SIZE][SIZE];
 
 int main(int argc, char *argv[]){
-  int sdl, mode;
-  Queue q;
-  Node *start, *current;
+  int solved;
+  Reader *r;
   char board[SIZE][SIZE];
-  FILE *file;
+  Options opt;
   /* Initialisations */
-  file = NULL;
-  sdl = OFF;
-  mode = BFS;
+  solved = 0;
+  readOptions(argc, argv, &opt);
+  r = (Reader *)malloc(sizeof(Reader));
+  if(r == NULL){
+    printf("Cannot Allocate Reader\n");
+    exit(2);
+  }
+  initZobrist();
+  openReader(r, argv[1]);
+  /* Select version, only asked for when no options are given,
+     so batch runs without a display never wait on the menu */
+  if(argc == 2){
+    versionSelect(&opt.sdl, &opt.mode);
+  }
+  /* Solve the boards one at a time as they are read */
   initialise(board);
+  while(nextBoard(r, board) == SUCCESS){
+    if(r->count > 1){
+      printf("##BOARD : %d##\n", r->count);
+    }
+    opt.board = r->count;
+    solved += solveBoard(board, &opt);
+    initialise(board);
+  }
+  closeReader(r);
+  free(r);
+  if(opt.out != NULL){
+    fclose(opt.out);
+  }
+  return solved > 0;
+}
+/**
+ * Read the options that follow the board file.
+ * -d searches with DFS instead of BFS, -b <file> writes binary
+ * solutions, -f <prefix> writes every step as a BMP frame and
+ * -s <prefix> writes one sprite sheet per board.
+ * Exit with the usage on anything else.
+ * 
+ * @param argc Number of arguments.
+ * @param argv The arguments.
+ * @param opt The options to fill.
+ * @return 1 on success.
+ */
+int readOptions(int argc, char *argv[], Options *opt){
+  int i;
+  opt->sdl = OFF;
+  opt->mode = BFS;
+  opt->out = NULL;
+  opt->frames = NULL;
+  opt->sheet = OFF;
+  opt->board = 0;
+  for(i = 2; i < argc; i++){
+    if(strcmp(argv[i], "-d") == 0){
+      opt->mode = DFS;
+    }
+    else if(i + 1 == argc){
+      break;
+    }
+    else if(strcmp(argv[i], "-b") == 0 && opt->out == NULL){
+      opt->out = fopen(argv[++i], "wb");
+      if(opt->out == NULL){
+	printf("Could not open file (%s). \n", argv[i]);
+	exit(2);
+      }
+      writeHeader(opt->out);
+    }
+    else if(strcmp(argv[i], "-f") == 0 || strcmp(argv[i], "-s") == 0){
+      opt->sheet = argv[i][1] == 's' ? ON : OFF;
+      opt->frames = argv[++i];
+    }
+    else{
+      break;
+    }
+  }
+  if(argc < 2 || i != argc){
+    printf("Usage : %s <board file> [-d] [-b <solution file>] "
+	   "[-f <frame prefix> | -s <sheet prefix>]\n", argv[0]);
+    exit(1);
+  }
+  return 1;
+}
+/**
+ * Solve one board and show the solution.
+ * 
+ * @param board The board.
+ * @param opt The search and output options.
+ * @return 1 on success, 0 when there is no solution.
+ */
+int solveBoard(char board[SIZE][SIZE], Options *opt){
+  Queue q;
+  Node *start, *current;
   initQueue(&q);
-  readFile(file, argv, board);
-  start = AllocateNode(board);
+  start = AllocateNode(board, computeHash(board));
   insertNode(&q,start);
-  /* Select version */
-  versionSelect(&sdl, &mode);
   printf("Computing...\n");
   /* Select BFS or DFS base on the selection above*/
-  if(mode == BFS){
+  if(opt->mode == BFS){
     current = moveBFS(&q);
   }
   else{
@@ -107,15 +241,47 @@ int main(int argc, char *argv[]){
   }
   else{
     printf("No solution found!\n");
+    if(opt->out != NULL){
+      writeSolution(opt->out, board, NULL);
+    }
+    freeSearch(start, opt->mode);
     return 0;
   }
+  /* DFS leaves the board at the end of the solution,
+     the first node still holds the start */
+  if(opt->out != NULL){
+    writeSolution(opt->out, current->board, current);
+  }
+  if(opt->frames != NULL){
+    exportFrames(current, opt);
+  }
   /* Show the correct solution in command line or in SDL*/
-  if(sdl == ON){
+  if(opt->sdl == ON){
     drawMove(current);
   }
-  else{
+  else if(opt->out == NULL && opt->frames == NULL){
     printSteps(current);
   }
+  freeSearch(start, opt->mode);
+  return 1;
+}
+/**
+ * Free every node left from solving a board.
+ * BFS keeps all the nodes it queued, in one list through next from
+ * the start. DFS frees the nodes it backs out of, so only the start
+ * and any solution are left, through previous once reversed.
+ * 
+ * @param start The first node of the search.
+ * @param mode Mode the board was solved with, BFS or DFS.
+ * @return 1 on success.
+ */
+int freeSearch(Node *start, int mode){
+  Node *p;
+  while(start != NULL){
+    p = start;
+    start = mode == BFS ? start->next : start->previous;
+    free(p);
+  }
   return 1;
 }
 /**
@@ -128,12 +294,15 @@ int main(int argc, char *argv[]){
  */
 int versionSelect(int *sdl, int *mode){
   int version;
+  version = 0;
   printf("Please select the version : \n\n");
   printf("1. Basic version(BFS + Command line) \n");
   printf("2. SDL version(BFS + SDL) \n");
   printf("3. Extension(DFS + SDL) \n\n");
   printf("Please enter a number : ");
-  scanf("%d",&version);
+  if(scanf("%d",&version) != 1){
+    version = 0;
+  }
 
   if(version == 1){*mode = BFS;*sdl = OFF;}
   else if(version == 2){*mode = BFS;*sdl = ON;}
@@ -145,36 +314,177 @@ int versionSelect(int *sdl, int *mode){
   return 1;
 }
 /**
- * Read the board from the input file.
+ * Open the board file for buffered reading.
  * Exit when the file does not exist.
+ * A file holds one or more boards of SIZE lines each, separated
+ * by blank lines, optionally preceded by a "width height" header.
  * 
- * @param file The file stream.
- * @param argv The file name gets from the command line.
- * @param board The initialised board.
+ * @param r The reader.
+ * @param name The file name gets from the command line.
  * @return 1 on success.
  */
-int readFile(FILE *file, char *argv[], char board[SIZE][SIZE]){
-  int i, j;
-  file = fopen(argv[1], "r");
+int openReader(Reader *r, char *name){
+  r->file = fopen(name, "r");
   /* fopen returns NULL pointer on failure */
-  if (file == NULL){
+  if (r->file == NULL){
     printf("Could not open file. \n");
     exit(2);
   }
-  else {
-    printf("File (%s) opened. \n", argv[1]);
+  printf("File (%s) opened. \n", name);
+  r->length = 0;
+  r->position = 0;
+  r->line = 1;
+  r->count = 0;
+  readHeader(r);
+  return 1;
+}
+/**
+ * Close the board file.
+ * 
+ * @param r The reader.
+ * @return 1 on success.
+ */
+int closeReader(Reader *r){
+  fclose(r->file);
+  return 1;
+}
+/**
+ * Get the next character, refilling the buffer a block at a time.
+ * 
+ * @param r The reader.
+ * @return The character, or EOF at the end of the file.
+ */
+int readChar(Reader *r){
+  int c;
+  if(r->position == r->length){
+    r->length = fread(r->buffer, 1, READ_BUFFER, r->file);
+    r->position = 0;
+    if(r->length == 0){
+      return EOF;
+    }
+  }
+  c = (unsigned char)r->buffer[r->position++];
+  if(c == '\n'){
+    r->line++;
+  }
+  return c;
+}
+/**
+ * Skip the rest of the current line.
+ * 
+ * @param r The reader.
+ * @return The last character read, '\n' or EOF.
+ */
+int skipLine(Reader *r){
+  int c;
+  do{
+    c = readChar(r);
+  }while(c != '\n' && c != EOF);
+  return c;
+}
+/**
+ * Read the optional "width height" geometry header.
+ * Exit when it does not match the SIZE the solver is built for.
+ * 
+ * @param r The reader.
+ * @return 1 if a header was read, 0 otherwise.
+ */
+int readHeader(Reader *r){
+  int c, width, height;
+  c = readChar(r);
+  if(c == EOF){
+    return 0;
+  }
+  /* Not a header, put the character back for nextBoard */
+  if(c < '0' || c > '9'){
+    r->position--;
+    if(c == '\n'){
+      r->line--;
+    }
+    return 0;
+  }
+  width = height = 0;
+  while(c >= '0' && c <= '9'){
+    width = width * 10 + c - '0';
+    c = readChar(r);
+  }
+  while(c == ' ' || c == '\t'){
+    c = readChar(r);
+  }
+  while(c >= '0' && c <= '9'){
+    height = height * 10 + c - '0';
+    c = readChar(r);
+  }
+  if(c == '\r'){
+    c = readChar(r);
+  }
+  if(c != '\n' || width != SIZE || height != SIZE){
+    printf("Unsupported board geometry on line 1, expected \"%d %d\".\n",
+	   SIZE, SIZE);
+    exit(2);
+  }
+  return 1;
+}
+/**
+ * Read the next valid board from the file.
+ * Blank lines between boards are skipped. A board with a wrong
+ * character or line length is reported and skipped.
+ * 
+ * @param r The reader.
+ * @param board The board to fill.
+ * @return SUCCESS when a board was read, FAIL at the end of the file.
+ */
+int nextBoard(Reader *r, char board[SIZE][SIZE]){
+  int c, i, j, first, valid;
+  for(;;){
+    /* Skip blank lines */
     do{
-      for(j = 0; j < SIZE; j++){
-	for(i = 0; i < SIZE; i++){
-	  board[j][i] = fgetc(file);
+      c = readChar(r);
+    }while(c == '\n' || c == '\r');
+    if(c == EOF){
+      return FAIL;
+    }
+    first = r->line;
+    valid = 1;
+    for(j = 0; j < SIZE && valid; j++){
+      for(i = 0; i < SIZE && valid; i++){
+	if(c != PEG && c != SPACE){
+	  valid = 0;
+	}
+	else{
+	  board[j][i] = c;
+	  c = readChar(r);
 	}
-	fgetc(file);
       }
-    }while(fgetc(file) != EOF);
-    /* Closing file */
-    fclose(file);
+      if(c == '\r'){
+	c = readChar(r);
+      }
+      if(valid && c != '\n' && c != EOF){
+	valid = 0;
+      }
+      else if(valid && j < SIZE - 1){
+	c = readChar(r);
+      }
+    }
+    r->count++;
+    if(valid){
+      return SUCCESS;
+    }
+    printf("Invalid board %d on line %d, skipped.\n", r->count, first);
+    /* Skip to the blank line that ends the bad board */
+    if(c != '\n'){
+      c = skipLine(r);
+    }
+    while(c != EOF){
+      c = readChar(r);
+      if(c == '\n' || c == EOF){
+	break;
+      }
+      if(c != '\r'){
+	c = skipLine(r);
+      }
+    }
   }
-  return 1;
 }
 /**
  * Check the board whether it is a final winning solution.
@@ -197,15 +507,13 @@ int checkWin(char board[SIZE][SIZE]){
  * @return 1 on success. 0 on failure.
  */
 int checkRepeat(Queue q, Node *p){
-  double queueID,nodeID;
   Node *temp;
-  char (*tempBoard)[SIZE];
   temp = q.front->next;
-  nodeID = computeID(p->board);
   while(temp != NULL){
-    tempBoard = temp->board;
-    queueID = computeID(tempBoard);
-    if(queueID == nodeID){
+    /* Hashes differ for almost every pair, so the board is only
+       compared when they match */
+    if(temp->hash == p->hash &&
+       memcmp(temp->board, p->board, sizeof(p->board)) == 0){
       return 1;
     }
     temp = temp->next;
@@ -213,24 +521,69 @@ int checkRepeat(Queue q, Node *p){
   return 0;
 }
 /**
- * Compute an unique id for the board.
+ * Fill the Zobrist table with one 64-bit random key per cell.
+ * A fixed seed (splitmix64) keeps the keys the same on every run.
+ * 
+ * @return 1 on success.
+ */
+int initZobrist(void){
+  int i, j;
+  uint64_t seed, z;
+  seed = ZOBRIST_SEED;
+  for(j = 0; j < SIZE; j++){
+    for(i = 0; i < SIZE; i++){
+      seed += 0x9E3779B97F4A7C15ULL;
+      z = seed;
+      z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+      z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+      zobrist[j][i] = z ^ (z >> 31);
+    }
+  }
+  return 1;
+}
+/**
+ * Compute the Zobrist hash of the board from scratch,
+ * the XOR of the keys of every cell holding a peg.
+ * Only needed for the start board, moves update it incrementally.
  * 
  * @param board The board.
- * @return id Return the computed id.
+ * @return hash Return the computed hash.
  */
-double computeID(char board[SIZE][SIZE]){
+uint64_t computeHash(char board[SIZE][SIZE]){
   int i, j;
-  double id;
-  id = 0;
+  uint64_t hash;
+  hash = 0;
   for(j = 0; j < SIZE; j++){
     for(i = 0; i < SIZE; i++){
       if(board[j][i] == PEG){
-	id++;
+	hash ^= zobrist[j][i];
       }
-      id = id * 10;
     }
   }
-  return id;
+  return hash;
+}
+/**
+ * Compute the change of hash made by a jump.
+ * A jump flips the three cells it touches, so the same key
+ * applies the move and takes it back.
+ * 
+ * @param direction The direction of move.
+ * @param x The row number. 
+ * @param y The column number.
+ * @return key The XOR of the three cell keys.
+ */
+uint64_t moveKey(int direction, int x, int y){
+  switch(direction){
+  case GO_LEFT :
+    return zobrist[y][x] ^ zobrist[y][x-1] ^ zobrist[y][x-2];
+  case GO_RIGHT :
+    return zobrist[y][x] ^ zobrist[y][x+1] ^ zobrist[y][x+2];
+  case GO_UP :
+    return zobrist[y][x] ^ zobrist[y-1][x] ^ zobrist[y-2][x];
+  case GO_DOWN :
+    return zobrist[y][x] ^ zobrist[y+1][x] ^ zobrist[y+2][x];
+  }
+  return 0;
 }
 /**
  * Allocate the new node the parent node.
@@ -256,53 +609,64 @@ Node *storeParents(Node *nextNode, Node *p){
  */
 Node *moveBFS(Queue *q){
   int i, j;
-  Node *result;
-  result = AllocateNode(q->front->board);
+  Node *p, *nextNode;
+  p = NULL;
   while(empty(q) != 1){
-    Node *p, *nextNode;
     p = removeNode(q);
     if(checkWin(p->board) == SUCCESS){
-      result = p;
-      result->flag = SUCCESS;
-      return result;
+      p->flag = SUCCESS;
+      return p;
     }
     for(j = 0; j < SIZE; j++){
       for(i = 0; i < SIZE; i++){
 	if(p->board[j][i] == PEG){
 	  if(checkLeft(p->board, i, j) == GO_LEFT){
-	    moveForward(p->board,GO_LEFT,i,j);
-	    nextNode = AllocateNode(p->board);
+	    moveForward(p->board,GO_LEFT,i,j,&p->hash);
+	    nextNode = AllocateNode(p->board, p->hash);
+	    nextNode->move = encodeMove(GO_LEFT,i,j);
 	    storeParents(nextNode,p);
-	    insertNode(q, nextNode);
-	    moveBack(p->board,GO_LEFT,i,j);
+	    if(insertNode(q, nextNode) == 0){
+	      free(nextNode);
+	    }
+	    moveBack(p->board,GO_LEFT,i,j,&p->hash);
 	  }
 	  if(checkRight(p->board, i, j) == GO_RIGHT){
-	    moveForward(p->board,GO_RIGHT,i,j);
-	    nextNode = AllocateNode(p->board);
+	    moveForward(p->board,GO_RIGHT,i,j,&p->hash);
+	    nextNode = AllocateNode(p->board, p->hash);
+	    nextNode->move = encodeMove(GO_RIGHT,i,j);
 	    storeParents(nextNode,p);
-	    insertNode(q, nextNode);
-	    moveBack(p->board,GO_RIGHT,i,j);
+	    if(insertNode(q, nextNode) == 0){
+	      free(nextNode);
+	    }
+	    moveBack(p->board,GO_RIGHT,i,j,&p->hash);
 	  }
 	  if(checkUp(p->board, i, j) == GO_UP){
-	    moveForward(p->board,GO_UP,i,j);
-	    nextNode = AllocateNode(p->board);
+	    moveForward(p->board,GO_UP,i,j,&p->hash);
+	    nextNode = AllocateNode(p->board, p->hash);
+	    nextNode->move = encodeMove(GO_UP,i,j);
 	    storeParents(nextNode,p);
-	    insertNode(q, nextNode);
-	    moveBack(p->board,GO_UP,i,j);
+	    if(insertNode(q, nextNode) == 0){
+	      free(nextNode);
+	    }
+	    moveBack(p->board,GO_UP,i,j,&p->hash);
 	  }
 	  if(checkDown(p->board, i, j) == GO_DOWN){
-	    moveForward(p->board,GO_DOWN,i,j);
-	    nextNode = AllocateNode(p->board);
+	    moveForward(p->board,GO_DOWN,i,j,&p->hash);
+	    nextNode = AllocateNode(p->board, p->hash);
+	    nextNode->move = encodeMove(GO_DOWN,i,j);
 	    storeParents(nextNode,p);
-	    insertNode(q, nextNode);
-	    moveBack(p->board,GO_DOWN,i,j);
+	    if(insertNode(q, nextNode) == 0){
+	      free(nextNode);
+	    }
+	    moveBack(p->board,GO_DOWN,i,j,&p->hash);
 	  }
 	}
       }
     }
   }
-  result->flag = FAIL;
-  return result;
+  /* The last board taken out, which led nowhere */
+  p->flag = FAIL;
+  return p;
 }
 /**
  * Print the queue in command line.
@@ -342,16 +706,21 @@ int empty(Queue *q){
 /**
  * Insert the node to the queue.
  * Check board in the node whether it is repeated.
+ * A node is linked after the last one ever inserted, even once the
+ * queue has emptied, so every node stays on one list to be freed.
  * @param q The queue.
  * @param p The node.
- * @return 1 on success. 0 on failure.
+ * @return 1 on success. 0 on failure, when the board is repeated.
  */
 int insertNode(Queue *q, Node *p){
   if(q->front == NULL){
+    if(q->back != NULL){
+      q->back->next = p;
+    }
     q->front = q->back = p;
-    return 0;
+    return 1;
   }
-  
+
   if(checkRepeat(*q,p) == 1){
     return 0;
   }
@@ -361,6 +730,8 @@ int insertNode(Queue *q, Node *p){
 }
 /**
  * Remove the node from the queue.
+ * The back is kept when the queue empties, for the next node to
+ * be linked after.
  * 
  * @param q The queue.
  * @return p Return the removed node.
@@ -372,7 +743,7 @@ Node *removeNode(Queue *q){
     return NULL;
   }
   if(q->front == q->back){
-    q->front = q->back = NULL;
+    q->front = NULL;
     return p;
   }
   q->front = p->next;
@@ -390,8 +761,10 @@ Node *removeNode(Queue *q){
  */
 Node *moveDFS(char board[SIZE][SIZE], Node *start){
   int i, j;
+  uint64_t hash;
   Node *current,*result;
   current = start;
+  hash = start->hash;
   if(checkWin(board) == SUCCESS){
     current->flag = SUCCESS;
     //printf("---FINISH---\n");
@@ -401,40 +774,44 @@ Node *moveDFS(char board[SIZE][SIZE], Node *start){
     for(i = 0; i < SIZE; i++){
       if(board[j][i] == PEG){
 	if(checkLeft(board, i, j) == GO_LEFT){
-	  moveForward(board,GO_LEFT,i,j);
-	  current = storeBoard(board, current);
+	  moveForward(board,GO_LEFT,i,j,&hash);
+	  current = storeBoard(board, hash, current);
+	  current->move = encodeMove(GO_LEFT,i,j);
  	  result = moveDFS(board,current);
 	  if(result->flag == SUCCESS){return result;}
-	  moveBack(board,GO_LEFT,i,j);
+	  moveBack(board,GO_LEFT,i,j,&hash);
 	  free(current);
-	  current = current->previous;
+	  current = start;
 	}
 	if(checkRight(board, i, j) == GO_RIGHT){
-	  moveForward(board,GO_RIGHT,i,j);
-	  current = storeBoard(board, current);
+	  moveForward(board,GO_RIGHT,i,j,&hash);
+	  current = storeBoard(board, hash, current);
+	  current->move = encodeMove(GO_RIGHT,i,j);
 	  result = moveDFS(board,current);
 	  if(result->flag == SUCCESS){return result;}
-	  moveBack(board,GO_RIGHT,i,j);
+	  moveBack(board,GO_RIGHT,i,j,&hash);
 	  free(current);
-	  current = current->previous;
+	  current = start;
 	}
 	if(checkUp(board, i, j) == GO_UP){
-	  moveForward(board,GO_UP,i,j);
-	  current = storeBoard(board, current);
+	  moveForward(board,GO_UP,i,j,&hash);
+	  current = storeBoard(board, hash, current);
+	  current->move = encodeMove(GO_UP,i,j);
 	  result = moveDFS(board,current);
 	  if(result->flag == SUCCESS){return result;}
-	  moveBack(board,GO_UP,i,j);
+	  moveBack(board,GO_UP,i,j,&hash);
 	  free(current);
-	  current = current->previous;
+	  current = start;
 	}
 	if(checkDown(board, i, j) == GO_DOWN){
-	  moveForward(board,GO_DOWN,i,j);
-	  current = storeBoard(board, current);
+	  moveForward(board,GO_DOWN,i,j,&hash);
+	  current = storeBoard(board, hash, current);
+	  current->move = encodeMove(GO_DOWN,i,j);
 	  result = moveDFS(board,current);
 	  if(result->flag == SUCCESS){return result;}
-	  moveBack(board,GO_DOWN,i,j);
+	  moveBack(board,GO_DOWN,i,j,&hash);
 	  free(current);
-	  current = current->previous;
+	  current = start;
 	}
       }
     }
@@ -446,12 +823,13 @@ Node *moveDFS(char board[SIZE][SIZE], Node *start){
  * Store the board in the node.
  * 
  * @param board The board.
+ * @param hash The hash of the board.
  * @param current The node.
  * @return current Return the node which stored the board.
  */
-Node *storeBoard(char board[SIZE][SIZE], Node *current){
+Node *storeBoard(char board[SIZE][SIZE], uint64_t hash, Node *current){
   Node *new;
-  new = AllocateNode(board);
+  new = AllocateNode(board, hash);
   new->previous = current;
   new->step = current->step;
   current = new;
@@ -465,9 +843,11 @@ Node *storeBoard(char board[SIZE][SIZE], Node *current){
  * @param direction The direction of move.
  * @param x The row number. 
  * @param y The column number.
+ * @param hash The hash of the board, updated for the three changed cells.
  * @return 0 on failure.
  */
-int moveForward(char board[SIZE][SIZE], int direction, int x, int y){
+int moveForward(char board[SIZE][SIZE], int direction, int x, int y, uint64_t *hash){
+  *hash ^= moveKey(direction, x, y);
   switch(direction){
   case GO_LEFT : 
     board[y][x] = SPACE;
@@ -499,9 +879,11 @@ int moveForward(char board[SIZE][SIZE], int direction, int x, int y){
  * @param direction The direction of move.
  * @param x The row number. 
  * @param y The column number.
+ * @param hash The hash of the board, updated for the three changed cells.
  * @return 0 on failure.
  */
-int moveBack(char board[SIZE][SIZE], int direction, int x, int y){
+int moveBack(char board[SIZE][SIZE], int direction, int x, int y, uint64_t *hash){
+  *hash ^= moveKey(direction, x, y);
   switch(direction){
   case GO_LEFT : 
     board[y][x] = PEG;
@@ -643,25 +1025,116 @@ int printBoard(char board[SIZE][SIZE]){
 }
 /**
  * Print out the moves from the list in command line.
+ * The text is built in a buffer and written a block at a time
+ * instead of one character per call.
  * 
  * @param current The list.
  * @return 1 on success.
  */
 int printSteps(Node *current){
+  char text[WRITE_BUFFER];
+  int length;
+  length = 0;
   while(current != NULL){
-    printf("##PEGS : %d STEP : %d##\n", countPegs(current->board),current->step);
-    printBoard(current->board);
+    /* Flush when a full step might not fit */
+    if(length > WRITE_BUFFER - 64 - SIZE * (SIZE + 1)){
+      fwrite(text, 1, length, stdout);
+      length = 0;
+    }
+    length += sprintf(text + length, "##PEGS : %d STEP : %d##\n",
+		      countPegs(current->board), current->step);
+    length += formatBoard(current->board, text + length);
     current = current->previous;
   }
+  fwrite(text, 1, length, stdout);
+  return 1;
+}
+/**
+ * Write the board as text, one line per row.
+ * 
+ * @param board The board.
+ * @param text The buffer to write into.
+ * @return The number of characters written.
+ */
+int formatBoard(char board[SIZE][SIZE], char *text){
+  int j;
+  for(j = 0; j < SIZE; j++){
+    memcpy(text, board[j], SIZE);
+    text[SIZE] = '\n';
+    text += SIZE + 1;
+  }
+  return SIZE * (SIZE + 1);
+}
+/**
+ * Encode a jump in one byte, the cell of the moving peg
+ * times four plus the direction.
+ * 
+ * @param direction The direction of move.
+ * @param x The row number. 
+ * @param y The column number.
+ * @return The encoded move.
+ */
+int encodeMove(int direction, int x, int y){
+  return (y * SIZE + x) * 4 + direction - 1;
+}
+/**
+ * Write the header of the binary solution file,
+ * "PEGS", the format version and SIZE.
+ * 
+ * @param out The solution file.
+ * @return 1 on success.
+ */
+int writeHeader(FILE *out){
+  unsigned char header[6] = {'P', 'E', 'G', 'S', 1, SIZE};
+  fwrite(header, 1, sizeof(header), out);
+  return 1;
+}
+/**
+ * Write one solution record to the binary solution file.
+ * A record is the start board with one bit per cell (set for a peg,
+ * row by row, lowest bit first), the number of jumps and one byte
+ * per jump from encodeMove(). The count is NO_SOLUTION and no jumps
+ * follow when the board has no solution.
+ * 
+ * @param out The solution file.
+ * @param board The start board.
+ * @param current The solution list from the start board, or NULL.
+ * @return 1 on success.
+ */
+int writeSolution(FILE *out, char board[SIZE][SIZE], Node *current){
+  unsigned char record[BOARD_BYTES + 1 + SIZE * SIZE];
+  int i, j, length;
+  memset(record, 0, BOARD_BYTES);
+  for(j = 0; j < SIZE; j++){
+    for(i = 0; i < SIZE; i++){
+      if(board[j][i] == PEG){
+	record[(j * SIZE + i) / 8] |= 1 << ((j * SIZE + i) % 8);
+      }
+    }
+  }
+  length = BOARD_BYTES + 1;
+  if(current == NULL){
+    record[BOARD_BYTES] = NO_SOLUTION;
+  }
+  else{
+    /* The start node has no move */
+    for(current = current->previous; current != NULL;
+	current = current->previous){
+      record[length++] = current->move;
+    }
+    record[BOARD_BYTES] = length - BOARD_BYTES - 1;
+  }
+  fwrite(record, 1, length, out);
   return 1;
 }
 /**
  * Allocate the board to the node.
  * initialise the node.
  * @param board The board.
+ * @param hash The hash of the board.
  * @return p Return the initialised node.
  */
-Node *AllocateNode(char board[SIZE][SIZE]){
+Node *AllocateNode(char board[SIZE][SIZE], uint64_t hash){
   Node *p;
   p = (Node *)malloc(sizeof(Node));
   if(p==NULL){
@@ -669,6 +1142,8 @@ Node *AllocateNode(char board[SIZE][SIZE]){
     exit(2);
   }
   copyBoard(p->board, board);
+  p->hash = hash;
+  p->move = NO_MOVE;
   p->previous = NULL;
   p->next = NULL;
   p->step = 0;
@@ -742,6 +1217,81 @@ int drawMove(Node* start){
   atexit(SDL_Quit);
   return 1;
 }
+/**
+ * Render the correct moves offscreen and save them as BMP files.
+ * No window is opened and there is no delay between steps.
+ * Each step is drawn with drawBoard, either into its own frame
+ * "<prefix><board>_<step>.bmp" or into a cell of one sprite sheet
+ * "<prefix><board>.bmp" laid out row by row.
+ * 
+ * @param start The list with the correct solution.
+ * @param opt The output options.
+ * @return 1 on success, 0 on failure.
+ */
+int exportFrames(Node *start, Options *opt){
+  SDL_Simplewin sw;
+  SDL_Surface *surface;
+  SDL_Rect frame;
+  Node *current;
+  char name[FRAME_NAME];
+  int steps, columns, rows;
+  steps = 0;
+  for(current = start; current != NULL; current = current->previous){
+    steps++;
+  }
+  columns = rows = 1;
+  if(opt->sheet == ON){
+    while(columns * columns < steps){
+      columns++;
+    }
+    rows = (steps + columns - 1) / columns;
+  }
+  surface = SDL_CreateRGBSurface(0, WWIDTH * columns, WHEIGHT * rows, 32,
+				 0x00FF0000, 0x0000FF00, 0x000000FF, 0);
+  if(surface == NULL){
+    printf("Cannot create frame : %s\n", SDL_GetError());
+    return 0;
+  }
+  sw.finished = 0;
+  sw.win = NULL;
+  sw.renderer = SDL_CreateSoftwareRenderer(surface);
+  if(sw.renderer == NULL){
+    printf("Cannot create renderer : %s\n", SDL_GetError());
+    SDL_FreeSurface(surface);
+    return 0;
+  }
+  Neill_SDL_SetDrawColour(&sw, BLACK, BLACK, BLACK);
+  SDL_RenderClear(sw.renderer);
+  frame.w = WWIDTH;
+  frame.h = WHEIGHT;
+  for(current = start; current != NULL; current = current->previous){
+    /* Each step is drawn into its own cell of the sheet */
+    frame.x = WWIDTH * (current->step % columns);
+    frame.y = WHEIGHT * (current->step / columns);
+    if(opt->sheet == OFF){
+      frame.x = frame.y = 0;
+      SDL_RenderSetViewport(sw.renderer, NULL);
+      Neill_SDL_SetDrawColour(&sw, BLACK, BLACK, BLACK);
+      SDL_RenderClear(sw.renderer);
+    }
+    SDL_RenderSetViewport(sw.renderer, &frame);
+    drawBoard(current->board, sw);
+    if(opt->sheet == OFF){
+      SDL_RenderPresent(sw.renderer);
+      snprintf(name, FRAME_NAME, "%s%d_%03d.bmp",
+	       opt->frames, opt->board, current->step);
+      SDL_SaveBMP(surface, name);
+    }
+  }
+  if(opt->sheet == ON){
+    SDL_RenderPresent(sw.renderer);
+    snprintf(name, FRAME_NAME, "%s%d.bmp", opt->frames, opt->board);
+    SDL_SaveBMP(surface, name);
+  }
+  SDL_DestroyRenderer(sw.renderer);
+  SDL_FreeSurface(surface);
+  return 1;
+}
 /**
  * Draw the board.
  * Pegs are drawn in black circle